@@ -0,0 +1,141 @@
+/**
+ * @file AnalysisCache.cpp
+ * @brief Implementation of the AnalysisCache class.
+ */
+
+#include "AnalysisCache.h"
+#include "CRC32C.h"
+#include "RowParser.h"
+#include "delimBuffer.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+static const char CacheMagic[8] = {'Z', 'I', 'P', 'S', 'T', 'A', 'T', 'S'};
+
+AnalysisCache::AnalysisCache(const string& sourceFileName, const string& cacheFileName)
+    : sourceFileName(sourceFileName),
+      cacheFileName(cacheFileName.empty() ? sourceFileName + ".stats" : cacheFileName),
+      cached(false) {}
+
+/**
+ * @brief Gives the analysis of the CSV file.
+ * @param stats Receives the per-state aggregates.
+ * @param forceAnalysis Re-parses the CSV even if the sidecar is current.
+ * @return False if neither the CSV nor the sidecar could be used.
+ */
+bool AnalysisCache::getStats(StateStats& stats, bool forceAnalysis) {
+    cached = false;
+    SourceKey key;
+    if (!statSource(key)) {
+        // without the CSV there is nothing to compare against, so any sidecar is served
+        CacheHeader header;
+        cached = readCache(header, stats);
+        return cached;
+    }
+
+    CacheHeader header;
+    bool haveCache = !forceAnalysis && readCache(header, stats);
+    if (haveCache && header.sourceSize == key.size) {
+        if (header.sourceTime == key.time) {
+            cached = true;
+            return true;
+        }
+        // touched but possibly unchanged: the hash decides
+        uint32_t hash;
+        if (hashSource(hash) && hash == header.sourceHash) {
+            writeCache(key, hash, stats);
+            cached = true;
+            return true;
+        }
+    }
+
+    StateStats fresh;
+    uint32_t hash;
+    if (!hashSource(hash) || !analyze(fresh))
+        return false;
+    stats = fresh;
+    writeCache(key, hash, stats);
+    return true;
+}
+
+bool AnalysisCache::statSource(SourceKey& key) const {
+    struct stat info;
+    if (stat(sourceFileName.c_str(), &info) != 0)
+        return false;
+    key.size = info.st_size;
+    key.time = int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    return true;
+}
+
+bool AnalysisCache::hashSource(uint32_t& hash) const {
+    ifstream in(sourceFileName, ios::binary);
+    if (!in.is_open())
+        return false;
+
+    char chunk[1 << 16];
+    hash = 0;
+    while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0)
+        hash = CRC32C::extend(hash, chunk, in.gcount());
+    return true;
+}
+
+bool AnalysisCache::readCache(CacheHeader& header, StateStats& stats) const {
+    ifstream in(cacheFileName, ios::binary);
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+    if (memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0 || header.version != Version
+        || header.stateCount != StateCodes::NumStates)
+        return false;
+
+    StateSummary summaries[StateCodes::NumStates];
+    if (!in.read(reinterpret_cast<char*>(summaries), sizeof(summaries)))
+        return false;
+    for (int i = 0; i < StateCodes::NumStates; i++)
+        stats.set(i, summaries[i]);
+    return true;
+}
+
+bool AnalysisCache::writeCache(const SourceKey& key, uint32_t hash, const StateStats& stats) const {
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CacheMagic, sizeof(header.magic));
+    header.version = Version;
+    header.stateCount = StateCodes::NumStates;
+    header.sourceSize = key.size;
+    header.sourceTime = key.time;
+    header.sourceHash = hash;
+
+    // written under a temporary name and renamed, so a reader never sees half a sidecar
+    string temporary = cacheFileName + ".tmp";
+    ofstream out(temporary, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (int i = 0; i < StateCodes::NumStates; i++)
+        out.write(reinterpret_cast<const char*>(&stats.get(i)), sizeof(StateSummary));
+    out.close();
+    if (!out)
+        return false;
+    return rename(temporary.c_str(), cacheFileName.c_str()) == 0;
+}
+
+// Parses every row of the CSV into the aggregates
+bool AnalysisCache::analyze(StateStats& stats) const {
+    ifstream in(sourceFileName);
+    if (!in.is_open())
+        return false;
+
+    delimBuffer b;
+    RowParser parser;
+    string headerData;
+    if (!b.readHeader(in, headerData) || !parser.resolveHeader(headerData))
+        return false;
+
+    // rows are added in file order, so ties go to the same record the import picks
+    ZipCode zip;
+    while (b.read(in)) {
+        if (!b.getBuffer().empty() && parser.parse(b.getBuffer(), zip))
+            stats.add(zip);
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file AnalysisCache.h
+ * @brief Keeps the per-state analysis of a CSV file in a sidecar file so it is only
+ *        recomputed when the CSV changes.
+ * @details The sidecar records the size, modification time and CRC-32C of the CSV it was
+ *          made from, followed by the StateSummary of every state. A sidecar whose size and
+ *          time match is served as is; if only the time differs the CSV is hashed, and an
+ *          unchanged hash keeps the sidecar (and refreshes its time) without re-parsing.
+ */
+
+#ifndef ANALYSISCACHE_H
+#define ANALYSISCACHE_H
+
+#include <cstdint>
+#include <string>
+#include "StateStats.h"
+using namespace std;
+
+class AnalysisCache {
+public:
+    /**
+     * @brief Format version written in the sidecar.
+     */
+    static const uint32_t Version = 1;
+
+    /**
+     * @brief Constructor for the AnalysisCache class.
+     * @param sourceFileName The CSV file that is analyzed.
+     * @param cacheFileName The sidecar, or empty for the CSV name followed by ".stats".
+     */
+    AnalysisCache(const string& sourceFileName, const string& cacheFileName = "");
+
+    /**
+     * @brief Gives the analysis of the CSV file.
+     * @param stats Receives the per-state aggregates.
+     * @param forceAnalysis Re-parses the CSV even if the sidecar is current.
+     * @post The sidecar is rewritten whenever the CSV was parsed. Returns false if the CSV
+     *       cannot be read and no sidecar could be used.
+     */
+    bool getStats(StateStats& stats, bool forceAnalysis = false);
+
+    /**
+     * @brief Tells whether the last getStats was served from the sidecar.
+     */
+    bool wasCached() const { return cached; }
+
+private:
+    // Start of the sidecar
+    struct CacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t stateCount;
+        uint64_t sourceSize;
+        int64_t sourceTime;      // modification time in nanoseconds
+        uint32_t sourceHash;     // CRC-32C of the whole CSV
+        uint32_t reserved;
+    };
+
+    // Identity of the CSV as it is on disk now
+    struct SourceKey {
+        uint64_t size;
+        int64_t time;
+    };
+
+    bool statSource(SourceKey& key) const;
+    bool hashSource(uint32_t& hash) const;
+    bool readCache(CacheHeader& header, StateStats& stats) const;
+    bool writeCache(const SourceKey& key, uint32_t hash, const StateStats& stats) const;
+    bool analyze(StateStats& stats) const;
+
+    string sourceFileName;
+    string cacheFileName;
+    bool cached;
+};
+
+#endif // ANALYSISCACHE_H
@@ -0,0 +1,52 @@
+/**
+ * @file Arena.cpp
+ * @brief Implementation of the Arena class.
+ */
+
+#include "Arena.h"
+#include <cstdint>
+
+Arena::Arena(size_t chunkSize)
+    : chunkSize(chunkSize), current(0), used(0), allocationCount(0), bytesAllocated(0) {
+}
+
+Arena::~Arena() {
+    for (auto& chunk : chunks) {
+        ::operator delete(chunk.data);
+    }
+}
+
+/**
+ * @brief Hands out memory from the current chunk, moving to the next chunk or taking a
+ *        new one from the system when it does not fit.
+ * @param bytes The size of the request.
+ * @param align The alignment of the request.
+ * @return The allocated storage.
+ */
+void* Arena::allocate(size_t bytes, size_t align) {
+    allocationCount++;
+    bytesAllocated += bytes;
+
+    while (current < chunks.size()) {
+        Chunk& chunk = chunks[current];
+        uintptr_t base = reinterpret_cast<uintptr_t>(chunk.data);
+        size_t offset = ((base + used + align - 1) & ~(uintptr_t)(align - 1)) - base;
+        if (offset + bytes <= chunk.size) {
+            used = offset + bytes;
+            return chunk.data + offset;
+        }
+        current++;      // chunks kept from before a reset are reused in order
+        used = 0;
+    }
+
+    Chunk chunk;
+    chunk.size = bytes + align > chunkSize ? bytes + align : chunkSize;
+    chunk.data = static_cast<char*>(::operator new(chunk.size));
+    chunks.push_back(chunk);
+    current = chunks.size() - 1;
+
+    uintptr_t base = reinterpret_cast<uintptr_t>(chunk.data);
+    size_t offset = ((base + align - 1) & ~(uintptr_t)(align - 1)) - base;
+    used = offset + bytes;
+    return chunk.data + offset;
+}
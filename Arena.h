@@ -0,0 +1,138 @@
+/**
+ * @file Arena.h
+ * @brief Monotonic arena for per-operation allocations, and an STL allocator that draws from it.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+using namespace std;
+
+class Arena {
+public:
+    /**
+     * @brief Position in the arena that rewind can return to.
+     */
+    struct Mark {
+        size_t chunk;
+        size_t used;
+    };
+
+    /**
+     * @brief Constructor for the Arena class.
+     * @param chunkSize Bytes requested from the system each time the arena runs out.
+     * @post The arena owns no memory until the first allocation.
+     */
+    explicit Arena(size_t chunkSize = 64 * 1024);
+
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * @brief Hands out memory from the current chunk.
+     * @pre align is a power of two.
+     * @post Returns storage that stays valid until the arena is reset or rewound past it.
+     */
+    void* allocate(size_t bytes, size_t align = alignof(max_align_t));
+
+    /**
+     * @brief Gives back every allocation but keeps the chunks for reuse.
+     */
+    void reset() { current = 0; used = 0; }
+
+    /**
+     * @brief Records the current position.
+     */
+    Mark mark() const { return Mark{current, used}; }
+
+    /**
+     * @brief Gives back every allocation made since m was taken.
+     * @pre m came from this arena and nothing before it has been given back.
+     */
+    void rewind(const Mark& m) { current = m.chunk; used = m.used; }
+
+    // Counters
+    // @brief allocate calls, chunks taken from the system, and bytes handed out, since construction.
+    size_t getAllocationCount() const { return allocationCount; }
+    size_t getSystemAllocationCount() const { return chunks.size(); }
+    size_t getBytesAllocated() const { return bytesAllocated; }
+
+private:
+    struct Chunk {
+        char* data;
+        size_t size;
+    };
+
+    size_t chunkSize;
+    size_t current;          // index of the chunk being carved
+    size_t used;             // bytes used in the current chunk
+    size_t allocationCount;
+    size_t bytesAllocated;
+    vector<Chunk> chunks;
+};
+
+/**
+ * @brief Rewinds an arena to where it was when the scope began.
+ * @details Scopes nest: an inner scope only gives back what was allocated inside it.
+ */
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena& arena) : arena(arena), start(arena.mark()) {}
+    ~ArenaScope() { arena.rewind(start); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    Arena& arena;
+    Arena::Mark start;
+};
+
+/**
+ * @brief STL allocator over an Arena. Without an arena it falls back to operator new,
+ *        so containers using it behave as usual when no arena is supplied.
+ */
+template <class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    ArenaAllocator(Arena* arena = nullptr) : arena(arena) {}
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.getArena()) {}
+
+    T* allocate(size_t n) {
+        if (arena != nullptr)
+            return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t) {
+        if (arena == nullptr)
+            ::operator delete(p);
+        // arena memory is given back all at once by reset or rewind
+    }
+
+    Arena* getArena() const { return arena; }
+
+private:
+    Arena* arena;
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.getArena() == b.getArena();
+}
+
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.getArena() != b.getArena();
+}
+
+#endif // ARENA_H
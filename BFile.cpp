@@ -4,25 +4,77 @@
  */
 
 #include "BFile.h"
+#include "KeySearch.h"
+#include "ReadSnapshot.h"
+#include <algorithm>
+#include <climits>
+#include <deque>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Each thread reads and decodes blocks in its own buffer
+static BlockBuffer& localBuffer() {
+    thread_local BlockBuffer buffer;
+    return buffer;
+}
+
+// Exclusive latches a writer holds together; add them in list order
+class WriteLatches {
+public:
+    explicit WriteLatches(BlockLatches& latches) : latches(latches) {}
+
+    void add(int rbn) {
+        if (rbn != 0)
+            held.emplace_back(latches.get(rbn));
+    }
+
+private:
+    BlockLatches& latches;
+    vector<unique_lock<BlockLatch>> held;
+};
+
+// Searches a lookup restarts after landing on a block a merge has freed
+static const int MaxLookupRetries = 16;
 
 /**
  * @brief Default constructor for BFile.
  * Initializes the class without opening a file.
+ * @param encoding The encoding of the blocks built from the length-indicated file.
  */
-BFile::BFile() {
+BFile::BFile(BlockEncoding encoding)
+    : firstRBN(1), availableSpace(0), totalBlocks(0), totalRecords(0), blockEncoding(encoding),
+      blockChecksums(false), scanThreads(0), fileName("DataFile.txt"), fd(-1) {
     string index = "IndexFile.index";
     string data = "data.txt";
 
-    outputData.open("DataFile.txt");
-    inputData.open("DataFile.txt");
+    fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
 
-    for (int i = 0; i < 1024; i++) {
-        outputData << '0';
-    }
+    string filler(1024, '0');
+    if (pwrite(fd, filler.data(), filler.size(), 0) != static_cast<ssize_t>(filler.size()))
+        return;
 
     lengthIndexToBlock(index, data);
 }
 
+/**
+ * @brief Opens a file for reading and writing operations.
+ * @param fileName The name of the file to open.
+ */
+void BFile::open(string fileName) {
+    close();
+    this->fileName = fileName;
+    fd = ::open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+}
+
+/**
+ * @brief Closes the currently opened file.
+ */
+void BFile::close() {
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+}
+
 /**
  * @brief Converts a length index to a block structure.
  * @param indexString The string index to be converted.
@@ -30,7 +82,6 @@ BFile::BFile() {
  */
 // Converts a length index to a block structure.
 void BFile::lengthIndexToBlock(string indexString, string lengthData) {
-    Buffer_Record recParser;
     LengthBuffer libuf;
     ZipCode z;
     PrimaryIndex pi(indexString, lengthData);
@@ -43,12 +94,10 @@ void BFile::lengthIndexToBlock(string indexString, string lengthData) {
 
     for (int i = 0; i < ind.size(); i++) {
         libuf.read(lid, ind[i].offset);
-        recParser.read(libuf.getBuffer());
-        recParser.unpack(z);
+        libuf.unpack(z);
         addRecord(z);
     }
-    outputData.seekp(0);
-    outputData << writeHeader();
+    flush();
 }
 
 /**
@@ -58,57 +107,220 @@ void BFile::lengthIndexToBlock(string indexString, string lengthData) {
  */
 // Deletes a record based on address.
 bool BFile::deleteRecord(string zipCode) {
-    Block currentBlock, previousBlock, nextBlock;
-    int rbn = blockIndex.Search(stoi(zipCode));
-    int prevRbn, nextRbn;
+    lock_guard<mutex> guard(writeLock);
+    bool deleted = deleteRecordLocked(zipCode);
+    if (underfull.size() >= MergeBatch)
+        mergeUnderfullLocked();
+    versions.commit();
+    return deleted;
+}
+
+// Deletes a record; the caller holds writeLock
+bool BFile::deleteRecordLocked(string zipCode) {
+    BlockBuffer& blockBuffer = localBuffer();
+    ArenaScope scope(*blockBuffer.getArena());
+    Block currentBlock(blockBuffer.getArena());
+    int zip = stoi(zipCode);
+    int rbn = blockIndex.Search(zip);
 
     if (rbn == 0)
         return false;
-    else {
-        blockBuffer.read(inputData, rbn);
-        blockBuffer.unpack(currentBlock);
-        prevRbn = currentBlock.getPreviousIndex();
-        nextRbn = currentBlock.getNextIndex();
-
-        if (currentBlock.removeRecord(stoi(zipCode))) {
-            if (currentBlock.getSize() < 256) {
-                if (prevRbn != 0) {
-                    blockBuffer.clear();
-                    blockBuffer.read(inputData, prevRbn);
-                    blockBuffer.unpack(previousBlock);
-                }
-                if (nextRbn != 0) {
-                    blockBuffer.clear();
-                    blockBuffer.read(inputData, nextRbn);
-                    blockBuffer.unpack(nextBlock);
-                }
-                if (previousBlock.getSize() < 256 && currentBlock.getSize() < 256) {
-                    Block mergedBlock(previousBlock, currentBlock);
-                    blockIndex.Add(mergedBlock, prevRbn);
-                    blockBuffer.pack(mergedBlock);
-                    blockBuffer.write(outputData, prevRbn);
-                    nextBlock.setPreviousIndex(prevRbn);
-                    blockBuffer.clear();
-                    blockBuffer.pack(nextBlock);
-                    blockBuffer.write(outputData, nextRbn);
-                    return true;
-                }
-                if (nextBlock.getSize() < 256 && currentBlock.getSize() < 256) {
-                    Block mergedBlock(currentBlock, nextBlock);
-                    blockIndex.Add(mergedBlock, nextRbn);
-                    blockBuffer.pack(mergedBlock);
-                    blockBuffer.write(outputData, nextRbn);
-                    previousBlock.setNextIndex(nextRbn);
-                    blockBuffer.clear();
-                    blockBuffer.pack(previousBlock);
-                    blockBuffer.write(outputData, prevRbn);
-                    return true;
-                }
-            }
-            return true;
-        } else
-            return false;
+
+    // writers are serialized, so blocks can be read before they are latched
+    blockBuffer.read(fd, rbn);
+    blockBuffer.unpack(currentBlock);
+    blockBuffer.clear();
+
+    if (!currentBlock.removeRecord(zip))
+        return false;
+    totalRecords--;
+
+    if (currentBlock.getRecordCount() == 0) {
+        // an emptied block has nothing to merge and is unlinked from its neighbours
+        underfull.erase(rbn);
+        unlinkBlock(currentBlock, rbn);
+        return true;
+    }
+
+    // only this block is rewritten; merging it with a neighbour waits for the next batch
+    WriteLatches held(latches);
+    held.add(rbn);
+    blockIndex.Add(currentBlock, rbn);
+    blockBuffer.pack(currentBlock);
+    writeBlock(blockBuffer, rbn);
+    if (currentBlock.getSize() < 256)
+        underfull.insert(rbn);
+    return true;
+}
+
+/**
+ * @brief Merges the blocks left less than half full by deletes.
+ * @return The number of blocks merged away.
+ */
+// Runs the deferred merges.
+int BFile::compact() {
+    lock_guard<mutex> guard(writeLock);
+    int merged = mergeUnderfullLocked();
+    versions.commit();
+    return merged;
+}
+
+// Merges every pending underfull block, in RBN order; the caller holds writeLock
+int BFile::mergeUnderfullLocked() {
+    int merged = 0;
+    while (!underfull.empty()) {
+        int rbn = *underfull.begin();
+        underfull.erase(underfull.begin());
+        if (mergeBlockLocked(rbn))
+            merged++;
+    }
+    return merged;
+}
+
+// Merges a block with a neighbour if both are less than half full; the caller holds writeLock
+bool BFile::mergeBlockLocked(int rbn) {
+    BlockBuffer& blockBuffer = localBuffer();
+    ArenaScope scope(*blockBuffer.getArena());
+    Arena* arena = blockBuffer.getArena();
+    Block currentBlock(arena), previousBlock(arena), nextBlock(arena), emptyBlock(arena);
+
+    blockBuffer.read(fd, rbn);
+    blockBuffer.unpack(currentBlock);
+    blockBuffer.clear();
+    // the block may have been emptied, or refilled, since it was queued
+    if (currentBlock.getRecordCount() == 0 || currentBlock.getSize() >= 256)
+        return false;
+
+    int prevRbn = currentBlock.getPreviousIndex();
+    int nextRbn = currentBlock.getNextIndex();
+    if (prevRbn != 0) {
+        blockBuffer.read(fd, prevRbn);
+        blockBuffer.unpack(previousBlock);
+        blockBuffer.clear();
+    }
+    if (nextRbn != 0) {
+        blockBuffer.read(fd, nextRbn);
+        blockBuffer.unpack(nextBlock);
+        blockBuffer.clear();
+    }
+
+    // the merged block keeps the RBN of the first of the pair in list order, and the
+    // other one is emptied onto the avail list
+    int keptRbn = 0, freedRbn = 0, followingRbn = 0;
+    bool intoPrevious = prevRbn != 0 && previousBlock.getSize() < 256;
+    if (intoPrevious) {
+        keptRbn = prevRbn;
+        freedRbn = rbn;
+        followingRbn = nextRbn;
+    } else if (nextRbn != 0 && nextBlock.getSize() < 256) {
+        keptRbn = rbn;
+        freedRbn = nextRbn;
+        followingRbn = nextBlock.getNextIndex();
+    } else {
+        return false;
+    }
+
+    Block mergedBlock = intoPrevious ? Block(previousBlock, currentBlock) : Block(currentBlock, nextBlock);
+    Block followingBlock(arena);
+    if (followingRbn != 0) {
+        blockBuffer.read(fd, followingRbn);
+        blockBuffer.unpack(followingBlock);
+        blockBuffer.clear();
+        followingBlock.setPreviousIndex(keptRbn);
+    }
+
+    WriteLatches held(latches);
+    held.add(keptRbn);
+    held.add(freedRbn);
+    held.add(followingRbn);
+
+    blockIndex.Add(mergedBlock, keptRbn);
+    blockIndex.Del(freedRbn);
+    blockBuffer.pack(mergedBlock);
+    writeBlock(blockBuffer, keptRbn);
+
+    emptyBlock.setPreviousIndex(0);
+    emptyBlock.setNextIndex(availableSpace);
+    blockBuffer.pack(emptyBlock);
+    writeBlock(blockBuffer, freedRbn);
+    availableSpace = freedRbn;
+
+    if (followingRbn != 0) {
+        blockBuffer.pack(followingBlock);
+        writeBlock(blockBuffer, followingRbn);
+    }
+
+    underfull.erase(freedRbn);
+    // a merged block still under half full may take in another neighbour
+    if (mergedBlock.getSize() < 256)
+        underfull.insert(keptRbn);
+    return true;
+}
+
+// Unlinks an emptied block from its neighbours and writes it empty; the caller holds writeLock
+void BFile::unlinkBlock(Block& emptied, int rbn) {
+    BlockBuffer& blockBuffer = localBuffer();
+    ArenaScope scope(*blockBuffer.getArena());
+    Block previousBlock(blockBuffer.getArena()), nextBlock(blockBuffer.getArena());
+    int prevRbn = emptied.getPreviousIndex();
+    int nextRbn = emptied.getNextIndex();
+
+    if (prevRbn != 0) {
+        blockBuffer.read(fd, prevRbn);
+        blockBuffer.unpack(previousBlock);
+        blockBuffer.clear();
+    }
+    if (nextRbn != 0) {
+        blockBuffer.read(fd, nextRbn);
+        blockBuffer.unpack(nextBlock);
+        blockBuffer.clear();
+    }
+
+    WriteLatches held(latches);
+    held.add(prevRbn);
+    held.add(rbn);
+    held.add(nextRbn);
+    blockIndex.Del(rbn);
+    if (prevRbn != 0) {
+        previousBlock.setNextIndex(nextRbn);
+        blockBuffer.pack(previousBlock);
+        writeBlock(blockBuffer, prevRbn);
+    } else if (nextRbn != 0) {
+        firstRBN = nextRbn;
+    }
+    if (nextRbn != 0) {
+        nextBlock.setPreviousIndex(prevRbn);
+        blockBuffer.pack(nextBlock);
+        writeBlock(blockBuffer, nextRbn);
+    }
+    emptied.setPreviousIndex(0);
+    emptied.setNextIndex(availableSpace);
+    blockBuffer.pack(emptied);
+    writeBlock(blockBuffer, rbn);
+    availableSpace = rbn;
+}
+
+// RBN for a new block: the head of the avail list, or else highest + 1, which highest
+// then becomes; the caller holds writeLock
+int BFile::newBlockLocked(int& highest) {
+    int rbn = availableSpace;
+    if (rbn == 0)
+        return ++highest;
+
+    // an empty block's next link is the rest of the avail list
+    BlockBuffer availBuffer;
+    Block freed;
+    if (!availBuffer.read(fd, rbn)) {
+        availableSpace = 0;
+        return ++highest;
     }
+    availBuffer.beginRecords(freed);
+    if (freed.getRecordCount() != 0) {
+        availableSpace = 0;     // not a free block: the list is not followed any further
+        return ++highest;
+    }
+    availableSpace = freed.getNextIndex();
+    return rbn;
 }
 
 /**
@@ -118,70 +330,408 @@ bool BFile::deleteRecord(string zipCode) {
  */
 // Adds a new ZipCode record to the file.
 bool BFile::addRecord(ZipCode &z) {
-    Block tempBlock, newBlock;
+    lock_guard<mutex> guard(writeLock);
+    bool added = addRecordLocked(z);
+    versions.commit();
+    return added;
+}
+
+// Adds a record; the caller holds writeLock
+bool BFile::addRecordLocked(ZipCode &z) {
+    BlockBuffer& blockBuffer = localBuffer();
+    ArenaScope scope(*blockBuffer.getArena());
+    Block tempBlock(blockBuffer.getArena());
     tempBlock.setActiveState(true);
     int rbn = blockIndex.Search(z.getNum());
 
     if (rbn == 0) {
-        if (totalBlocks == 0) totalBlocks++;
         rbn = blockIndex.FindHighest();
 
         if (rbn == 0) {
+            tempBlock.setEncoding(blockEncoding);
+            tempBlock.setChecksum(blockChecksums);
             tempBlock.insertRecord(z);
             tempBlock.setPreviousIndex(0);
             tempBlock.setNextIndex(0);
-            blockIndex.Add(tempBlock, 1);
 
+            // an emptied list starts again in a block from the avail list
+            int highest = totalBlocks;
+            rbn = newBlockLocked(highest);
+            WriteLatches held(latches);
+            held.add(rbn);
+            totalBlocks = highest;
+            blockIndex.Add(tempBlock, rbn);
+            blockBuffer.clear();    // pack appends, and a lookup may have left a block here
             blockBuffer.pack(tempBlock);
-            blockBuffer.write(outputData, 1);
-            blockBuffer.clear();
+            writeBlock(blockBuffer, rbn);
+            firstRBN = rbn;
 
+            totalRecords++;
             return true;
+        }
+    }
+
+    blockBuffer.read(fd, rbn);
+    blockBuffer.unpack(tempBlock);
+    blockBuffer.clear();
+
+    // zip codes are the primary key
+    if (KeySearch::find(tempBlock.getKeys(), tempBlock.getRecordCount(), z.getNum()) >= 0)
+        return false;
+
+    if (!tempBlock.insertRecord(z)) {
+        // each retry lands in a block at most half as full; one record alone cannot be split
+        int before = tempBlock.getRecordCount();
+        if (before < 2 || !splitLocked(tempBlock) || tempBlock.getRecordCount() >= before)
+            return false;
+        return addRecordLocked(z);
+    }
+
+    WriteLatches held(latches);
+    held.add(rbn);
+    blockIndex.Add(tempBlock, rbn);
+    blockBuffer.pack(tempBlock);
+    writeBlock(blockBuffer, rbn);
+    totalRecords++;
+    return true;
+}
+
+/**
+ * @brief Replaces a record in place.
+ * @param z The new version of the record.
+ * @return True if the record was replaced, false if its zip code is not in the file.
+ */
+// Updates a record's fields.
+bool BFile::updateRecord(const ZipCode& z) {
+    lock_guard<mutex> guard(writeLock);
+    bool updated = updateRecordLocked(z);
+    versions.commit();
+    return updated;
+}
+
+// Replaces a record; the caller holds writeLock
+bool BFile::updateRecordLocked(const ZipCode& z) {
+    BlockBuffer& blockBuffer = localBuffer();
+    ArenaScope scope(*blockBuffer.getArena());
+    Block tempBlock(blockBuffer.getArena());
+    tempBlock.setActiveState(true);
+    int rbn = blockIndex.Search(z.getNum());
+
+    if (rbn == 0)
+        return false;
+
+    blockBuffer.read(fd, rbn);
+    blockBuffer.unpack(tempBlock);
+    blockBuffer.clear();
+
+    if (KeySearch::find(tempBlock.getKeys(), tempBlock.getRecordCount(), z.getNum()) < 0)
+        return false;
+
+    if (!tempBlock.replaceRecord(z)) {
+        // the longer record does not fit; the half that keeps it is at most half as full,
+        // and a record alone in its block has nowhere to go
+        int before = tempBlock.getRecordCount();
+        if (before < 2 || !splitLocked(tempBlock) || tempBlock.getRecordCount() >= before)
+            return false;
+        return updateRecordLocked(z);
+    }
+
+    // the zip code and the block's highest zip are unchanged, so the index is too
+    WriteLatches held(latches);
+    held.add(rbn);
+    blockBuffer.pack(tempBlock);
+    writeBlock(blockBuffer, rbn);
+    return true;
+}
+
+/**
+ * @brief Applies a batch of sorted changes, reading and writing each block once.
+ * @param changes Adds and removals in increasing zip order, at most one per zip code.
+ * @return The number of records added, replaced or removed.
+ */
+// Merges a sorted batch into the sequence set.
+int BFile::applyChanges(const vector<RecordChange>& changes) {
+    lock_guard<mutex> guard(writeLock);
+    int applied = applyChangesLocked(changes);
+    if (underfull.size() >= MergeBatch)
+        mergeUnderfullLocked();
+    versions.commit();
+    return applied;
+}
+
+/**
+ * @brief Deletes a set of zip codes in one batch.
+ * @param zips The zip codes to delete, in any order.
+ * @return The number of records deleted.
+ */
+// Deletes many zip codes with one write per block.
+int BFile::removeRecords(const vector<int>& zips) {
+    vector<int> sorted(zips);
+    sort(sorted.begin(), sorted.end());
+    sorted.erase(unique(sorted.begin(), sorted.end()), sorted.end());
+
+    vector<RecordChange> changes;
+    changes.reserve(sorted.size());
+    for (int zip : sorted)
+        changes.push_back(RecordChange{zip, true, ZipCode()});
+    return applyChanges(changes);
+}
+
+// Applies a sorted batch block by block; the caller holds writeLock
+int BFile::applyChangesLocked(const vector<RecordChange>& changes) {
+    BlockBuffer& blockBuffer = localBuffer();
+    Arena* arena = blockBuffer.getArena();
+    vector<ZipCode> merged;
+    int applied = 0;
+    size_t next = 0;
+
+    while (next < changes.size()) {
+        ArenaScope scope(*arena);
+        Block current(arena);
+        int rbn = blockIndex.Search(changes[next].zip);
+        if (rbn == 0)
+            rbn = blockIndex.FindHighest();     // past the highest zip: the last block takes it
+
+        if (rbn == 0) {
+            // no block is linked, so there is nothing to remove; the first add starts the list
+            if (changes[next].remove) {
+                next++;
+                continue;
+            }
+            int highest = totalBlocks;
+            rbn = newBlockLocked(highest);
+            totalBlocks = highest;
+            firstRBN = rbn;
+            current.setEncoding(blockEncoding);
+            current.setChecksum(blockChecksums);
+            current.setPreviousIndex(0);
+            current.setNextIndex(0);
+            blockBuffer.clear();    // pack appends, and a lookup may have left a block here
         } else {
-            blockBuffer.read(inputData, rbn);
-            blockBuffer.unpack(tempBlock);
+            blockBuffer.read(fd, rbn);
+            blockBuffer.unpack(current);
             blockBuffer.clear();
-            blockIndex.Add(tempBlock, rbn);
+        }
 
-            if (!tempBlock.insertRecord(z)) {
-                split(tempBlock);
-                return addRecord(z);
+        // a record that does not fit in an empty block with the widest links this batch can
+        // give it is rejected, and a record it would have replaced stays
+        int widestLink = totalBlocks + current.getRecordCount() + static_cast<int>(changes.size()) + 1;
+        Block alone(arena);
+        alone.setEncoding(current.getEncoding());
+        alone.setChecksum(current.hasChecksum());
+        alone.setPreviousIndex(widestLink);
+        alone.setNextIndex(widestLink);
+
+        // the block takes every change up to its highest zip; the last block takes the rest
+        int bound = current.getNextIndex() == 0 ? INT_MAX : current.getMaximumZip();
+        const ZipCode* record = current.begin();
+        const ZipCode* end = current.end();
+        int blockApplied = 0, blockRecords = 0;
+        merged.clear();
+        for (; next < changes.size() && changes[next].zip <= bound; next++) {
+            const RecordChange& change = changes[next];
+            while (record != end && record->getNum() < change.zip)
+                merged.push_back(*record++);
+            if (!change.remove) {
+                alone.clearRecords();
+                if (!alone.insertRecord(change.record))
+                    continue;
+            }
+            bool present = record != end && record->getNum() == change.zip;
+            if (present)
+                record++;
+
+            if (!change.remove) {
+                merged.push_back(change.record);
+                if (!present)
+                    blockRecords++;
+            } else if (present) {
+                blockRecords--;
             } else {
-                blockBuffer.pack(tempBlock);
-                blockBuffer.write(outputData, rbn);
-                blockBuffer.clear();
-                return true;
+                continue;   // removing a zip code that is not there changes nothing
             }
+            blockApplied++;
         }
-    } else {
-        blockBuffer.read(inputData, rbn);
-        blockBuffer.unpack(tempBlock);
-        blockBuffer.clear();
-        blockIndex.Add(tempBlock, rbn);
+        merged.insert(merged.end(), record, end);
+        if (blockApplied == 0)
+            continue;
+        applied += blockApplied;
+        totalRecords += blockRecords;
 
-        if (!tempBlock.insertRecord(z)) {
-            split(tempBlock);
-            return addRecord(z);
-        } else {
-            blockIndex.Add(tempBlock, rbn);
-            blockBuffer.pack(tempBlock);
-            blockBuffer.write(outputData, rbn);
-            blockBuffer.clear();
+        if (merged.empty()) {
+            current.clearRecords();
+            underfull.erase(rbn);
+            unlinkBlock(current, rbn);
+            continue;
+        }
+
+        // refill the block in order, continuing into new blocks linked after it
+        int nextRbn = current.getNextIndex();
+        // links are part of the header size, so each piece is filled with links at least
+        // as long as the ones it ends up with; the new pieces get their RBNs once the
+        // number of pieces is settled
+        int widestNext = max(nextRbn, totalBlocks + static_cast<int>(merged.size()));
+        deque<Block> pieces;
+        vector<int> rbns;
+        auto fill = [&](size_t perPiece) {
+            pieces.clear();
+            for (const ZipCode& z : merged) {
+                if (pieces.empty() || pieces.back().getRecordCount() >= static_cast<int>(perPiece)
+                    || !pieces.back().insertRecord(z)) {
+                    bool first = pieces.empty();
+                    pieces.emplace_back(arena);
+                    pieces.back().setEncoding(current.getEncoding());
+                    pieces.back().setChecksum(current.hasChecksum());
+                    pieces.back().setActiveState(true);
+                    pieces.back().setPreviousIndex(first ? current.getPreviousIndex() : widestNext);
+                    pieces.back().setNextIndex(widestNext);
+                    if (!pieces.back().insertRecord(z))
+                        return false;
+                }
+            }
             return true;
+        };
+        bool filled = fill(merged.size());
+        // an overflowing block is spread evenly over the blocks it needs, as a split would
+        if (filled && pieces.size() > 1)
+            filled = fill((merged.size() + pieces.size() - 1) / pieces.size());
+        if (!filled) {
+            // every new record was probed above, so only one already stored can fail to
+            // fit; the block is left as it was and none of its changes count
+            applied -= blockApplied;
+            totalRecords -= blockRecords;
+            continue;
+        }
+        int startBlocks = totalBlocks;      // RBNs above this are past the end of the file
+        int highestRbn = startBlocks;
+        rbns.assign(1, rbn);
+        for (size_t k = 1; k < pieces.size(); k++)
+            rbns.push_back(newBlockLocked(highestRbn));
+        for (size_t k = 0; k < pieces.size(); k++) {
+            if (k > 0)
+                pieces[k].setPreviousIndex(rbns[k - 1]);
+            pieces[k].setNextIndex(k + 1 < pieces.size() ? rbns[k + 1] : nextRbn);
+        }
+
+        // the block after the pieces links back to the last one; a longer link can push a
+        // full block past its capacity, and such a block is split like any other, which
+        // can carry on down the list
+        deque<Block> tail;
+        vector<int> tailRbns;
+        int linkFrom = rbns.back();
+        int link = pieces.size() > 1 ? nextRbn : 0;
+        while (link != 0) {
+            tail.emplace_back(arena);
+            Block& following = tail.back();
+            blockBuffer.read(fd, link);
+            blockBuffer.unpack(following);
+            blockBuffer.clear();
+            following.setPreviousIndex(linkFrom);
+            tailRbns.push_back(link);
+            if (following.getSize() <= Block::Capacity)
+                break;
+
+            int after = following.getNextIndex();
+            int extraRbn = newBlockLocked(highestRbn);
+            tail.emplace_back(arena);
+            Block& extra = tail.back();
+            following.divideBlock(extra);
+            following.setNextIndex(extraRbn);
+            extra.setPreviousIndex(link);
+            extra.setActiveState(true);
+            tailRbns.push_back(extraRbn);
+            linkFrom = extraRbn;
+            link = after;
+        }
+
+        // blocks past the end of the file are written before any link or index entry
+        // leads to them, so they need no latch; the others, including blocks taken from
+        // the avail list that a stale lookup may still read, are latched in list order
+        for (size_t k = 1; k < pieces.size(); k++) {
+            if (rbns[k] > startBlocks) {
+                blockBuffer.pack(pieces[k]);
+                writeBlock(blockBuffer, rbns[k]);
+            }
+        }
+        for (size_t k = 0; k < tail.size(); k++) {
+            if (tailRbns[k] > startBlocks) {
+                blockBuffer.pack(tail[k]);
+                writeBlock(blockBuffer, tailRbns[k]);
+            }
+        }
+
+        WriteLatches held(latches);
+        held.add(rbn);
+        for (size_t k = 1; k < pieces.size(); k++)
+            if (rbns[k] <= startBlocks)
+                held.add(rbns[k]);
+        for (size_t k = 0; k < tail.size(); k++)
+            if (tailRbns[k] <= startBlocks)
+                held.add(tailRbns[k]);
+        totalBlocks = max(totalBlocks.load(), highestRbn);
+
+        for (size_t k = 0; k < pieces.size(); k++)
+            blockIndex.Add(pieces[k], rbns[k]);
+        for (size_t k = 0; k < tail.size(); k++)
+            blockIndex.Add(tail[k], tailRbns[k]);
+        blockBuffer.pack(pieces[0]);
+        writeBlock(blockBuffer, rbn);
+        for (size_t k = 1; k < pieces.size(); k++) {
+            if (rbns[k] <= startBlocks) {
+                blockBuffer.pack(pieces[k]);
+                writeBlock(blockBuffer, rbns[k]);
+            }
+        }
+        for (size_t k = 0; k < tail.size(); k++) {
+            if (tailRbns[k] <= startBlocks) {
+                blockBuffer.pack(tail[k]);
+                writeBlock(blockBuffer, tailRbns[k]);
+            }
         }
+        // removals only shrink the block; merging it waits for the next batch
+        if (pieces.size() == 1 && pieces[0].getSize() < 256)
+            underfull.insert(rbn);
     }
-    return false;
+    return applied;
+}
+
+// Value of the "name: value" line of a header, or fallback when the line is missing
+static int headerField(const string& header, const string& name, int fallback) {
+    size_t at = header.find(name + ": ");
+    if (at == string::npos)
+        return fallback;
+    return atoi(header.c_str() + at + name.size() + 2);
 }
 
 /**
  * @brief Reads the header information from the current file.
+ * @post The counts, list heads and encoding are those the header records, and the
+ *       block index is rebuilt from the highest key of each active block.
  */
 // Reads the file header.
 void BFile::readHeader() {
-    string temp;
-    inputData.seekg(0);
-    for (int i = 0; i < FILESIZE; i++) {
-        temp.push_back(inputData.get());
+    string temp(FILESIZE, '\0');
+    ssize_t got = pread(fd, &temp[0], FILESIZE, 0);
+    temp.resize(got > 0 ? got : 0);
+
+    totalRecords = headerField(temp, "Record Count", 0);
+    totalBlocks = headerField(temp, "Block Count", 0);
+    availableSpace = headerField(temp, "First Available Block", 0);
+    firstRBN = headerField(temp, "First Active Block", 1);
+    if (temp.find("compressed records") != string::npos)
+        blockEncoding = COMPRESSED_BLOCK;
+
+    BlockBuffer& blockBuffer = localBuffer();
+    Block block;
+    // a damaged link cannot walk more blocks than the file has; the verifier reports it
+    int rbn = firstRBN;
+    for (int seen = 0; rbn > 0 && rbn <= totalBlocks && seen < totalBlocks; seen++) {
+        if (!blockBuffer.read(fd, rbn))
+            break;
+        blockBuffer.beginRecords(block);
+        if (block.getRecordCount() > 0)
+            blockIndex.Add(block, rbn);
+        rbn = block.getNextIndex();
     }
 }
 
@@ -202,7 +752,10 @@ string BFile::writeHeader() {
     header.append("Header Size: 512 bytes\n");
 
     // Size Format
-    header.append("Format: ASCII\n");
+    if (blockEncoding == COMPRESSED_BLOCK)
+        header.append("Format: ASCII block headers, compressed records\n");
+    else
+        header.append("Format: ASCII\n");
 
     // Block size
     header.append("Block Size: 512 bytes\n");
@@ -226,6 +779,16 @@ string BFile::writeHeader() {
     header.append(to_string(totalBlocks));
     header.push_back('\n');
 
+    // RBN link to avail list, ahead of the descriptive lines so it fits in the 512 byte header
+    header.append("First Available Block: ");
+    header.append(to_string(availableSpace));
+    header.push_back('\n');
+
+    // RBN link to active list
+    header.append("First Active Block: ");
+    header.append(to_string(firstRBN));
+    header.push_back('\n');
+
     // Fields per record
     header.append("Fields: 6\n");
 
@@ -238,16 +801,6 @@ string BFile::writeHeader() {
     // Primary key
     header.append("Zip code is the first key\n");
 
-    // RBN link to avail list
-    header.append("First Available Block: ");
-    header.append(to_string(availableSpace));
-    header.push_back('\n');
-
-    // RBN link to active list
-    header.append("First Active Block: ");
-    header.append(to_string(firstRBN));
-    header.push_back('\n');
-
     // Stale flag
     header.append("Stale: true");
     header.push_back('\n');
@@ -256,91 +809,51 @@ string BFile::writeHeader() {
 }
 
 /**
- * @brief Provides a physical representation of the file's data.
- * @return String containing a physical dump of the file.
+ * @brief Writes a physical representation of the file's data.
+ * @param out The writer to stream to.
  */
-// Provides a physical dump of the file's data.
-string BFile::physicalDump() {
-    string output = "";
-    output.append("List Head: ");
-    output.append(to_string(getFirstRBN()));
-    output.append("\nAvail Head: ");
-    output.append(to_string(getAvailableSpace()));
-    output.append("\n");
-
-    Block tempBlock;
-    vector<ZipCode> records;
-
-    for (int i = 1; i <= totalBlocks; ++i) {
-        blockBuffer.read(inputData, i);
-        blockBuffer.unpack(tempBlock);
-        blockBuffer.clear();
+// Streams a physical dump of the file's data.
+void BFile::physicalDump(DumpWriter& out) {
+    out << "List Head: " << getFirstRBN();
+    out << "\nAvail Head: " << getAvailableSpace();
+    out << "\n";
 
-        if (tempBlock.isActive()) {
-            output.append("RBN Prev: ");
-            output.append(to_string(tempBlock.getPreviousIndex()));
-            tempBlock.fetchRecords(records);
+    // each worker formats its blocks into the chunk's text; chunks are written in order
+    auto visit = [](int, BlockBuffer& buffer, string& text) {
+        Block tempBlock;
+        ZipCodeView record;
+        buffer.beginRecords(tempBlock);
 
-            for (int j = 0; j < tempBlock.getRecordCount(); j++) {
-                output.push_back(' ');
-                output.append(to_string(records[j].getNum()));
-                output.push_back(' ');
+        if (tempBlock.getRecordCount() > 0) {
+            text.append("RBN Prev: ");
+            NumberCodec::appendInt(text, tempBlock.getPreviousIndex());
+
+            while (buffer.nextRecord(record)) {
+                text.push_back(' ');
+                NumberCodec::appendInt(text, record.getNum());
+                text.push_back(' ');
             }
 
-            output.append("RBN Next: ");
-            output.append(to_string(tempBlock.getNextIndex()));
-            output.append("\n");
+            text.append("RBN Next: ");
+            NumberCodec::appendInt(text, tempBlock.getNextIndex());
+            text.append("\n");
         } else {
-            output.append("RBN Prev:0\t*AVAILABLE*\tRBN Next: 0\n");
+            text.append("RBN Prev:0\t*AVAILABLE*\tRBN Next: 0\n");
         }
-    }
-
-    return output;
+    };
+    scanBlocks<string>(visit, [&out](string& text) { out << text; });
+    out.flush();
 }
 
 /**
- * @brief Provides a logical representation of the file's data.
- * @return String containing a logical dump of the file.
+ * @brief Writes a logical representation of the file's data.
+ * @param out The writer to stream to.
  */
-// Provides a logical dump of the file's data.
-string BFile::logicalDump() {
-    int rbn = 1;
-    Block tempBlock;
-    string zips;
-    vector<ZipCode> records;
-
-    zips.append("List Head: ");
-    zips.append(to_string(getFirstRBN()));
-    zips.append("\nAvail Head: ");
-    zips.append(to_string(getAvailableSpace()));
-    zips.append("\n");
-
-    for (int i = 1; i <= totalBlocks; ++i) {
-        if (rbn == 0) break;
-        blockBuffer.read(inputData, rbn);
-        blockBuffer.unpack(tempBlock);
-        blockBuffer.clear();
-
-        if (tempBlock.isActive()) {
-            zips.append("RBN Prev: ");
-            zips.append(to_string(tempBlock.getPreviousIndex()));
-            tempBlock.fetchRecords(records);
-
-            for (int j = 0; j < records.size(); j++) {
-                zips.append(to_string(records[j].getNum()));
-                zips.push_back(' ');
-            }
-
-            zips.append("RBN Prev: ");
-            zips.append(to_string(tempBlock.getNextIndex()));
-            zips.push_back('\n');
-            rbn = tempBlock.getNextIndex();
-        } else {
-            zips.append("RBN Prev:0\t*AVAILABLE*\tRBN Next: 0\n");
-        }
-    }
-
-    return zips;
+// Streams a logical dump of the file's data.
+void BFile::logicalDump(DumpWriter& out) {
+    // a dump taken while writers run still shows the file as of one moment
+    ReadSnapshot snapshot(*this);
+    snapshot.logicalDump(out);
 }
 
 /**
@@ -350,40 +863,189 @@ string BFile::logicalDump() {
  */
 // Splits a block into two parts.
 bool BFile::split(Block& b) {
+    lock_guard<mutex> guard(writeLock);
+    bool divided = splitLocked(b);
+    versions.commit();
+    return divided;
+}
+
+// Splits a block; the caller holds writeLock
+bool BFile::splitLocked(Block& b) {
     if (b.isActive()) {
-        int rbn, tempIndex;
-        Block tempBlock1, tempBlock2;
+        BlockBuffer& blockBuffer = localBuffer();
+        ArenaScope scope(*blockBuffer.getArena());
+        Block tempBlock1(blockBuffer.getArena()), tempBlock2(blockBuffer.getArena());
 
-        rbn = blockIndex.Search(b.calculateHighestZip());
+        int rbn = blockIndex.Search(b.calculateHighestZip());
+        int highest = totalBlocks;
+        int newRbn = newBlockLocked(highest);
+        int nextRbn = b.getNextIndex();
         b.divideBlock(tempBlock1);
 
-        if (b.getNextIndex() == 0) {
-            tempBlock1.setNextIndex(0);
-        } else {
-            tempIndex = b.getNextIndex();
-            blockBuffer.read(inputData, tempIndex);
+        if (nextRbn != 0) {
+            blockBuffer.read(fd, nextRbn);
             blockBuffer.unpack(tempBlock2);
-
-            tempBlock1.setNextIndex(tempIndex);
-            tempBlock2.setPreviousIndex(totalBlocks);
             blockBuffer.clear();
+            tempBlock2.setPreviousIndex(newRbn);
         }
 
-        b.setNextIndex(++totalBlocks);
+        tempBlock1.setNextIndex(nextRbn);
         tempBlock1.setPreviousIndex(rbn);
         tempBlock1.setActiveState(true);
+        b.setNextIndex(newRbn);
 
-        blockBuffer.pack(b);
-        blockBuffer.write(outputData, rbn);
-        blockBuffer.clear();
-        blockIndex.Add(b, rbn);
+        // the new block sits between b and its old next block in the list
+        WriteLatches held(latches);
+        held.add(rbn);
+        held.add(newRbn);
+        held.add(nextRbn);
+        totalBlocks = highest;
 
         blockBuffer.pack(tempBlock1);
-        blockBuffer.write(outputData, totalBlocks);
-        blockBuffer.clear();
-        blockIndex.Add(tempBlock1, totalBlocks);
+        writeBlock(blockBuffer, newRbn);
+        blockIndex.Add(tempBlock1, newRbn);
+
+        if (nextRbn != 0) {
+            blockBuffer.pack(tempBlock2);
+            writeBlock(blockBuffer, nextRbn);
+        }
+
+        blockBuffer.pack(b);
+        writeBlock(blockBuffer, rbn);
+        blockIndex.Add(b, rbn);
 
         return true;
     }
     return false;
 }
+
+/**
+ * @brief Finds a record without copying it out of the block.
+ * @param zip The zip code to look for.
+ * @param result Receives a view of the record.
+ * @return True if the zip code is in the file.
+ */
+// Looks up a record in place.
+bool BFile::findRecord(int zip, ZipCodeView& result) {
+    BlockBuffer& blockBuffer = localBuffer();
+    Block header;
+
+    for (int attempt = 0; attempt < MaxLookupRetries; attempt++) {
+        int rbn = blockIndex.Search(zip);
+        if (rbn == 0)
+            return false;
+
+        shared_lock<BlockLatch> latch(latches.get(rbn));
+        // the block may have been freed and reused since the index was read; its entry
+        // only changes under its write latch, so one check under the latch is enough
+        if (blockIndex.Search(zip) != rbn)
+            continue;
+        for (;;) {
+            blockBuffer.read(fd, rbn);
+            blockBuffer.beginRecords(header);
+            if (header.getRecordCount() == 0)
+                break;      // freed by a merge after the index was read: search again
+
+            if (zip <= header.getMaximumZip()) {
+                while (blockBuffer.nextRecord(result)) {
+                    if (result.getNum() == zip)
+                        return true;
+                    if (result.getNum() > zip)
+                        break;      // records are kept in zip order
+                }
+                return false;
+            }
+
+            // split after the index was read: the zip moved to a block further right
+            rbn = header.getNextIndex();
+            if (rbn == 0)
+                return false;
+            shared_lock<BlockLatch> nextLatch(latches.get(rbn));
+            latch.swap(nextLatch);
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Finds a record and copies it into an owning ZipCode.
+ * @param zip The zip code to look for.
+ * @param result Receives the record.
+ * @return True if the zip code is in the file.
+ */
+// Looks up a record and copies it out.
+bool BFile::findRecord(int zip, ZipCode& result) {
+    ZipCodeView view;
+    if (!findRecord(zip, view))
+        return false;
+    result = view.toZipCode();
+    return true;
+}
+
+/**
+ * @brief Finds every record in a range of zip codes.
+ * @param low The lowest zip code wanted.
+ * @param high The highest zip code wanted.
+ * @param result Receives copies of the records, in zip order.
+ * @return The number of records found.
+ */
+// Follows the block links from the block that would hold low.
+int BFile::findRange(int low, int high, vector<ZipCode>& result) {
+    BlockBuffer& blockBuffer = localBuffer();
+    Block header;
+    ZipCodeView record;
+
+    for (int attempt = 0; attempt < MaxLookupRetries; attempt++) {
+        int rbn = blockIndex.Search(low);
+        if (rbn == 0)
+            return 0;
+
+        int found = 0;
+        shared_lock<BlockLatch> latch(latches.get(rbn));
+        if (blockIndex.Search(low) != rbn)
+            continue;       // freed and reused since the index was read, as in findRecord
+        for (int visited = 0; rbn != 0 && visited < totalBlocks; visited++) {
+            blockBuffer.read(fd, rbn);
+            blockBuffer.beginRecords(header);
+            if (header.getRecordCount() == 0)
+                break;      // only the first block can have been freed; search again
+
+            while (blockBuffer.nextRecord(record)) {
+                if (record.getNum() > high)
+                    return found;
+                if (record.getNum() >= low) {
+                    result.push_back(record.toZipCode());
+                    found++;
+                }
+            }
+
+            // holding this block keeps its next block linked until that one is latched
+            rbn = header.getNextIndex();
+            if (rbn != 0) {
+                shared_lock<BlockLatch> nextLatch(latches.get(rbn));
+                latch.swap(nextLatch);
+            }
+        }
+        if (rbn == 0 || found > 0)
+            return found;
+    }
+    return 0;
+}
+
+// Writes a block, first saving the image it replaces for any open snapshot
+void BFile::writeBlock(BlockBuffer& blockBuffer, int rbn) {
+    versions.preserve(fd, rbn);
+    blockBuffer.write(fd, rbn);
+}
+
+/**
+ * @brief Writes the file header.
+ */
+// Rewrites the header so its counts match the blocks.
+void BFile::flush() {
+    lock_guard<mutex> guard(writeLock);
+    string header = writeHeader();
+    header.resize(FILESIZE, '0');
+    if (pwrite(fd, header.data(), header.size(), 0) != static_cast<ssize_t>(header.size()))
+        return;
+}
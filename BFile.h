@@ -6,30 +6,77 @@
 #include "BlockBuffer.h"
 #include "Buffer_Record.h"
 #include "zipCode.h"
+#include "ZipCodeView.h"
 #include "Block.h"
 #include "BlockIndex.h"
 #include "LengthBuffer.h"
 #include "PrimaryIndex.h"
+#include "DumpWriter.h"
+#include "ParallelScan.h"
+#include "BlockVerifier.h"
+#include "BlockLatches.h"
+#include "VersionStore.h"
+#include <atomic>
+#include <mutex>
+#include <set>
 
 const int FILESIZE = 512;
 
+class ReadSnapshot;
+
+/**
+ * @brief One change in a batch given to BFile::applyChanges.
+ */
+struct RecordChange {
+    int zip;
+    bool remove;        // true to delete the zip code, false to add or replace it
+    ZipCode record;     // the new record when remove is false
+};
+
+/**
+ * @brief Blocked sequence set file that many threads may use at once.
+ * @details Lookups take a shared latch on each block they read and couple latches while
+ *          moving along the next links: the next block is latched before the current
+ *          one is released. Writers are serialized among themselves and take exclusive
+ *          latches, in list order, on every block a change touches, so a reader sees each
+ *          block either before or after a split or merge. Blocks emptied by deletes and
+ *          merges go on the avail list and are reused before the file grows, so a lookup
+ *          checks that the index still names the first block it latches. Blocks are read
+ *          and written with pread and pwrite, and each thread decodes into its own
+ *          BlockBuffer.
+ *          A ReadSnapshot sees the whole file as of one moment while writers go on; the
+ *          blocks writers overwrite meanwhile are kept in a VersionStore until it is
+ *          released. logicalDump reads through a snapshot. The other full-file scans
+ *          (physicalDump, scanBlocks, verify) read without latches and are meant for a
+ *          file that is not being written.
+ */
 class BFile {
 public:
     /**
      * @brief Constructs a new BlockFile object with default settings.
+     * @param encoding The encoding of the blocks built from the length-indicated file.
      */
-    BFile() {
-        // Default constructor implementation
-    }
+    explicit BFile(BlockEncoding encoding = ASCII_BLOCK);
 
     /**
      * @brief Constructs a BlockFile object and opens a specific file.
      * @param fileName The name of the file to be opened.
      */
-    BFile(string fileName) {
+    BFile(string fileName)
+        : firstRBN(1), availableSpace(0), totalBlocks(0), totalRecords(0), blockEncoding(ASCII_BLOCK),
+          blockChecksums(false), scanThreads(0), fd(-1) {
         open(fileName);
+        readHeader();
     }
 
+    /**
+     * @brief Closes the file.
+     */
+    ~BFile() { close(); }
+
+    BFile(const BFile&) = delete;
+    BFile& operator=(const BFile&) = delete;
+
     /**
      * @brief Converts a length index to a block structure.
      * @param indexString The string index to be converted.
@@ -41,21 +88,17 @@ public:
      * @brief Opens a file for reading and writing operations.
      * @param fileName The name of the file to open.
      */
-    void open(string fileName) {
-        inputData.open(fileName);
-        outputData.open(fileName);
-    }
+    void open(string fileName);
 
     /**
      * @brief Closes the currently opened file.
      */
-    void close() {
-        inputData.close();
-        outputData.close();
-    }
+    void close();
 
     /**
      * @brief Reads the header information from the current file.
+     * @post The counts, list heads and encoding are those the header records, and the
+     *       block index is rebuilt from the highest key of each active block.
      */
     void readHeader();
 
@@ -66,16 +109,36 @@ public:
     string writeHeader();
 
     /**
-     * @brief Provides a physical representation of the file's data.
-     * @return String containing a physical dump of the file.
+     * @brief Writes a physical representation of the file's data, block by block in RBN order.
+     * @param out The writer to stream to. Output starts with the first block and memory
+     *            use does not grow with the file.
+     * @details Blocks are read and formatted by a ParallelScan and written in RBN order.
      */
-    string physicalDump();
+    void physicalDump(DumpWriter& out);
 
     /**
-     * @brief Provides a logical representation of the file's data.
-     * @return String containing a logical dump of the file.
+     * @brief Writes a physical dump to a stream.
      */
-    string logicalDump();
+    void physicalDump(ostream& out) {
+        DumpWriter writer(out);
+        physicalDump(writer);
+    }
+
+    /**
+     * @brief Writes a logical representation of the file's data, following the block links.
+     * @param out The writer to stream to.
+     * @details The dump is read from a ReadSnapshot, so writers are not held up by it and
+     *          it shows no write that finished after it started.
+     */
+    void logicalDump(DumpWriter& out);
+
+    /**
+     * @brief Writes a logical dump to a stream.
+     */
+    void logicalDump(ostream& out) {
+        DumpWriter writer(out);
+        logicalDump(writer);
+    }
 
     /**
      * @brief Splits a block into two separate blocks.
@@ -91,13 +154,112 @@ public:
      */
     bool addRecord(ZipCode& zipCode);
 
+    /**
+     * @brief Replaces a record with a new version that has the same zip code.
+     * @param zipCode The new record.
+     * @return True if the zip code was in the file and its record was replaced.
+     * @details The record is rewritten inside its block, which is the only block written,
+     *          and the block index is not touched. Only when the new record does not fit
+     *          is the block split and the record replaced in the half that holds it.
+     */
+    bool updateRecord(const ZipCode& zipCode);
+
+    /**
+     * @brief Blocks left less than half full that wait before they are merged.
+     */
+    static const size_t MergeBatch = 64;
+
     /**
      * @brief Deletes a ZipCode record from the file.
      * @param zipCode The zip code of the record to delete.
      * @return True if the record was deleted successfully, false otherwise.
+     * @details Only the record's block is rewritten. A block left less than half full is
+     *          queued, and the queue is merged with the neighbours once it holds
+     *          MergeBatch blocks, or when compact is called.
      */
     bool deleteRecord(string zipCode);
 
+    /**
+     * @brief Deletes a set of zip codes, rewriting each block that holds one of them once.
+     * @param zips The zip codes to delete, in any order; missing ones are ignored.
+     * @return The number of records deleted.
+     */
+    int removeRecords(const vector<int>& zips);
+
+    /**
+     * @brief Merges every block deletes have left less than half full with a neighbour.
+     * @return The number of blocks merged away.
+     */
+    int compact();
+
+    /**
+     * @brief Number of blocks waiting to be merged.
+     */
+    size_t getUnderfullCount() {
+        lock_guard<mutex> guard(writeLock);
+        return underfull.size();
+    }
+
+    /**
+     * @brief Applies a batch of changes in one pass along the sequence set.
+     * @param changes Adds and removals sorted by zip code, with at most one change per
+     *                zip code. An add replaces a record that is already there, and a
+     *                removal of a missing zip code is ignored.
+     * @return The number of records added, replaced or removed.
+     * @details Each block the batch touches is read once and rewritten in order, spilling
+     *          into new blocks linked after it when it overflows, instead of one
+     *          read-modify-write and possible split per record. Blocks left empty are
+     *          unlinked, and blocks left less than half full are queued for merging as
+     *          deleteRecord does. The batch is one write, so a ReadSnapshot sees all of it
+     *          or none.
+     */
+    int applyChanges(const vector<RecordChange>& changes);
+
+    /**
+     * @brief Finds a record without copying it out of the block.
+     * @param zip The zip code to look for.
+     * @param result Receives the record. Its text fields point into the calling thread's
+     *               block buffer and stay valid until that thread's next call on a BFile.
+     * @return True if the zip code is in the file.
+     */
+    bool findRecord(int zip, ZipCodeView& result);
+
+    /**
+     * @brief Finds a record and copies it into an owning ZipCode.
+     * @param zip The zip code to look for.
+     * @param result Receives a copy of the record.
+     * @return True if the zip code is in the file.
+     */
+    bool findRecord(int zip, ZipCode& result);
+
+    /**
+     * @brief Finds every record whose zip code is between low and high, inclusive.
+     * @param result Receives copies of the records, in zip order.
+     * @return The number of records found.
+     */
+    int findRange(int low, int high, vector<ZipCode>& result);
+
+    /**
+     * @brief Writes the file header and flushes the blocks written so far.
+     * @post The header's record and block counts describe the file on disk.
+     */
+    void flush();
+
+    /**
+     * @brief Retrieves the number of records in the file.
+     */
+    int getRecordCount() const { return totalRecords; }
+
+    /**
+     * @brief Retrieves the number of blocks in the file.
+     */
+    int getBlockCount() const { return totalBlocks; }
+
+    /**
+     * @brief Number of old block images kept for open ReadSnapshots.
+     */
+    size_t getVersionCount() const { return versions.getVersionCount(); }
+
     /**
      * @brief Retrieves the first relative block number (RBN) in the file.
      * @return The first RBN as an integer.
@@ -110,13 +272,84 @@ public:
      */
     int getAvailableSpace() const { return availableSpace; }
 
+    /**
+     * @brief The highest zip and RBN of every block, as kept while the file is built.
+     */
+    const BlockIndex& getBlockIndex() const { return blockIndex; }
+
+    /**
+     * @brief Chooses the encoding of blocks this BFile creates.
+     * @details Blocks already in the file keep the encoding in their header, and the
+     *          halves of a split keep the encoding of the block that was split.
+     */
+    void setEncoding(BlockEncoding encoding) { blockEncoding = encoding; }
+
+    BlockEncoding getEncoding() const { return blockEncoding; }
+
+    /**
+     * @brief Chooses whether blocks this BFile creates carry a CRC32C field.
+     * @details As with the encoding, existing blocks keep what their header says and the
+     *          halves of a split keep the setting of the block that was split.
+     */
+    void setChecksums(bool enabled) { blockChecksums = enabled; }
+
+    bool getChecksums() const { return blockChecksums; }
+
+    /**
+     * @brief Checks the file's blocks, links and block index.
+     * @return The report of a BlockVerifier run over this file.
+     */
+    VerifyReport verify() {
+        BlockVerifier verifier(fileName, firstRBN, &blockIndex, scanThreads);
+        return verifier.run();
+    }
+
+    /**
+     * @brief Chooses how many threads full-file scans use; 0 means one per hardware thread.
+     */
+    void setScanThreads(int threads) { scanThreads = threads; }
+
+    /**
+     * @brief Runs a ParallelScan over every block of the file.
+     * @param visit Called as visit(rbn, buffer, result) on worker threads; see ParallelScan::run.
+     * @param emit Called as emit(result) on this thread, once per chunk, in RBN order.
+     * @pre Blocks written through this BFile have been flushed, which write() does.
+     * @return False if the workers could not open the file.
+     */
+    template <class Result, class Visit, class Emit>
+    bool scanBlocks(Visit visit, Emit emit) {
+        ParallelScan scan(fileName, 1, totalBlocks, scanThreads);
+        return scan.run<Result>(visit, emit);
+    }
+
 private:
-    int firstRBN, availableSpace, totalBlocks, totalRecords;
+    friend class ReadSnapshot;
+
+    bool addRecordLocked(ZipCode& zipCode);
+    bool deleteRecordLocked(string zipCode);
+    bool updateRecordLocked(const ZipCode& zipCode);
+    int mergeUnderfullLocked();
+    bool mergeBlockLocked(int rbn);
+    int applyChangesLocked(const vector<RecordChange>& changes);
+    void unlinkBlock(Block& emptied, int rbn);
+    int newBlockLocked(int& highest);
+    bool splitLocked(Block& b);
+    void writeBlock(BlockBuffer& blockBuffer, int rbn);
+
+    atomic<int> firstRBN;
+    int availableSpace;
+    atomic<int> totalBlocks, totalRecords;
+    BlockEncoding blockEncoding;
+    bool blockChecksums;
+    int scanThreads;
+    string fileName;
 
-    ofstream outputData;
-    ifstream inputData;
-    BlockBuffer blockBuffer;
+    int fd;                 // read and written only with pread and pwrite
+    mutex writeLock;        // one writer at a time
+    set<int> underfull;     // blocks waiting to be merged, guarded by writeLock
+    BlockLatches latches;
     BlockIndex blockIndex;
+    VersionStore versions;  // old block images kept for open snapshots
 };
 
 #endif //BFILE
@@ -4,24 +4,40 @@
  * @author Group 7
  * @details This file contains the implementation of the Block class, which includes
  *          methods for manipulating blocks of ZipCode records, such as adding, removing,
- *          and splitting blocks.
+ *          and splitting blocks. Record sizes, the payload total and the highest zip are
+ *          kept up to date on every change, so no method re-encodes or rescans records.
+ *          The zip keys live in their own array next to the record payloads; searches run
+ *          over the keys alone and only read a record once its position is known.
+ *          A compressed block's payload depends on its neighbouring records and its
+ *          dictionaries, so it is measured again whenever the records change.
  */
 
 #include "Block.h"
+#include "NumberCodec.h"
+#include "RecordCodec.h"
+#include "KeySearch.h"
+#include "CompressedBlockCodec.h"
+#include <algorithm>
 
 /**
  * @brief Constructor that initializes a new, empty block.
+ * @param arena Arena the record storage is drawn from, or nullptr for the heap.
  * @post Creates a block with default initial values and clears any existing records.
  */
 // Constructor: Initializes a new, empty block
-Block::Block() {
+Block::Block(Arena* arena)
+    : keys(ArenaAllocator<int>(arena)), records(ArenaAllocator<ZipCode>(arena)),
+      recordSizes(ArenaAllocator<short>(arena)) {
     active = false;
     recCount = 0;
-    currentSize = calculateHeaderSize() + 1;
     highestZip = 0;
-    prev = 0; 
+    prev = 0;
     next = 0;
-    records.clear();
+    encoding = ASCII_BLOCK;
+    checksummed = false;
+    payloadSize = 0;
+    compressedSize = 0;
+    updateSize();
 }
 
 /**
@@ -30,14 +46,17 @@ Block::Block() {
  * @post Creates a new Block object as a copy of the provided Block.
  */
 // Copy constructor: Creates a copy of an existing block
-Block::Block(const Block& old) {
+Block::Block(const Block& old) : keys(old.keys), records(old.records), recordSizes(old.recordSizes) {
     active = old.active;
     recCount = old.recCount;
     currentSize = old.currentSize;
     highestZip = old.highestZip;
     prev = old.prev;
     next = old.next;
-    records = old.records; // Using direct assignment for vector copy
+    encoding = old.encoding;
+    checksummed = old.checksummed;
+    payloadSize = old.payloadSize;
+    compressedSize = old.compressedSize;
 }
 
 /**
@@ -48,22 +67,33 @@ Block::Block(const Block& old) {
  */
 // Merge constructor: Merges two blocks into one
 Block::Block(Block& firstBlock, Block& secondBlock) {
-    if (secondBlock.getMaximumZip() < firstBlock.getMaximumZip()) {
-        swap(firstBlock, secondBlock);
+    Block* first = &firstBlock;
+    Block* second = &secondBlock;
+    if (second->getMaximumZip() < first->getMaximumZip()) {
+        swap(first, second);
     }
 
-    records.reserve(firstBlock.records.size() + secondBlock.records.size());
-    records.insert(records.end(), firstBlock.records.begin(), firstBlock.records.end());
-    records.insert(records.end(), secondBlock.records.begin(), secondBlock.records.end());
+    keys.reserve(first->keys.size() + second->keys.size());
+    keys.insert(keys.end(), first->keys.begin(), first->keys.end());
+    keys.insert(keys.end(), second->keys.begin(), second->keys.end());
+    records.reserve(keys.size());
+    records.insert(records.end(), first->records.begin(), first->records.end());
+    records.insert(records.end(), second->records.begin(), second->records.end());
+    recordSizes.reserve(records.size());
+    recordSizes.insert(recordSizes.end(), first->recordSizes.begin(), first->recordSizes.end());
+    recordSizes.insert(recordSizes.end(), second->recordSizes.begin(), second->recordSizes.end());
 
     active = true;
-    recCount = firstBlock.recCount + secondBlock.recCount;
-    currentSize = firstBlock.currentSize + secondBlock.currentSize;
-    prev = firstBlock.prev;
-    next = secondBlock.next;
-    secondBlock.active = false;
+    recCount = records.size();
+    encoding = first->encoding;
+    checksummed = first->checksummed;
+    payloadSize = first->payloadSize + second->payloadSize;
+    prev = first->prev;
+    next = second->next;
+    second->active = false;
 
     calculateHighestZip();
+    refreshSize();
 }
 
 /**
@@ -74,20 +104,107 @@ Block::Block(Block& firstBlock, Block& secondBlock) {
  * @return Boolean indicating whether the record was successfully added.
  */
 // Inserts a new ZipCode record into the block
-bool Block::insertRecord(ZipCode& newZip) {
-    int tempsize = calculateHeaderSize();
+bool Block::insertRecord(const ZipCode& newZip) {
     int count = calculateZipSize(newZip);
+    int newHighest = max(highestZip, newZip.getNum());
 
-    if (count + currentSize < 512) {
-        auto position = lower_bound(records.begin(), records.end(), newZip,
-                                    [](const ZipCode& a, const ZipCode& b) { return a.getNum() < b.getNum(); });
-        records.insert(position, newZip);
-        recCount++;
-        calculateHighestZip();
-        currentSize = (currentSize - tempsize) + calculateHeaderSize();
-        return true;
+    if (encoding == ASCII_BLOCK && calculateBlockSize(recCount + 1, newHighest, payloadSize + count) > Capacity)
+        return false;
+
+    int position = lowerBound(newZip.getNum());
+    keys.insert(keys.begin() + position, newZip.getNum());
+    records.insert(records.begin() + position, newZip);
+    recordSizes.insert(recordSizes.begin() + position, static_cast<short>(count));
+
+    if (encoding == COMPRESSED_BLOCK) {
+        // the new record changes its neighbour's deltas and may grow a dictionary,
+        // so the payload is measured with the record in place
+        int packed = CompressedBlockCodec::encodedSize(records.data(), records.size());
+        if (calculateBlockSize(recCount + 1, newHighest, packed) > Capacity) {
+            keys.erase(keys.begin() + position);
+            records.erase(records.begin() + position);
+            recordSizes.erase(recordSizes.begin() + position);
+            return false;
+        }
+        compressedSize = packed;
     }
-    return false;
+    recCount++;
+    payloadSize += count;
+    highestZip = newHighest;
+    updateSize();
+    return true;
+}
+
+/**
+ * @brief Appends a record that sorts after every record in the Block.
+ * @param newZip The record to add.
+ * @post The record is the last one in the Block. The size is stale until finishAppends.
+ */
+// Appends a record while decoding a block
+void Block::appendRecord(const ZipCode& newZip) {
+    int count = calculateZipSize(newZip);
+    keys.push_back(newZip.getNum());
+    records.push_back(newZip);
+    recordSizes.push_back(static_cast<short>(count));
+    recCount++;
+    payloadSize += count;
+    highestZip = newZip.getNum();
+}
+
+/**
+ * @brief Recomputes the size once after a run of appendRecord calls.
+ */
+// Measures the block once all decoded records are in
+void Block::finishAppends() {
+    refreshSize();
+}
+
+/**
+ * @brief Replaces a record with a new version of it.
+ * @param newZip The new record; its zip code selects the record replaced.
+ * @post The record is replaced if it is in the Block and the Block still fits.
+ * @return Boolean indicating whether the record was replaced.
+ */
+// Replaces a ZipCode record in the block
+bool Block::replaceRecord(const ZipCode& newZip) {
+    int position = KeySearch::find(keys.data(), keys.size(), newZip.getNum());
+    if (position < 0)
+        return false;
+
+    int count = calculateZipSize(newZip);
+    int newPayload = payloadSize - recordSizes[position] + count;
+    if (encoding == ASCII_BLOCK && calculateBlockSize(recCount, highestZip, newPayload) > Capacity)
+        return false;
+
+    ZipCode old = records[position];
+    records[position] = newZip;
+    if (encoding == COMPRESSED_BLOCK) {
+        int packed = CompressedBlockCodec::encodedSize(records.data(), records.size());
+        if (calculateBlockSize(recCount, highestZip, packed) > Capacity) {
+            records[position] = old;
+            return false;
+        }
+        compressedSize = packed;
+    }
+    recordSizes[position] = static_cast<short>(count);
+    payloadSize = newPayload;
+    updateSize();
+    return true;
+}
+
+/**
+ * @brief Removes every record but keeps the links and the storage.
+ */
+// Empties the block
+void Block::clearRecords() {
+    keys.clear();
+    records.clear();
+    recordSizes.clear();
+    recCount = 0;
+    payloadSize = 0;
+    compressedSize = 0;
+    highestZip = 0;
+    updateSize();
 }
 
 /**
@@ -99,18 +216,30 @@ bool Block::insertRecord(ZipCode& newZip) {
 // Splits the block into two blocks
 void Block::divideBlock(Block& newBlock) {
     int midpoint = records.size() / 2;
+    int movedBytes = 0;
+    for (size_t i = midpoint; i < recordSizes.size(); i++) {
+        movedBytes += recordSizes[i];
+    }
+
+    newBlock.keys.assign(keys.begin() + midpoint, keys.end());
     newBlock.records.assign(records.begin() + midpoint, records.end());
+    newBlock.recordSizes.assign(recordSizes.begin() + midpoint, recordSizes.end());
     newBlock.recCount = newBlock.records.size();
+    newBlock.encoding = encoding;
+    newBlock.checksummed = checksummed;
+    newBlock.payloadSize = movedBytes;
     newBlock.calculateHighestZip();
-    newBlock.currentSize = newBlock.calculateHeaderSize() + newBlock.calculateZipSize(newBlock.records);
+    newBlock.refreshSize();
 
+    keys.resize(midpoint);
     records.resize(midpoint);
+    recordSizes.resize(midpoint);
     recCount = records.size();
+    payloadSize -= movedBytes;
     calculateHighestZip();
-    currentSize = calculateHeaderSize() + calculateZipSize(records);
+    refreshSize();
 
     newBlock.setNextIndex(getNextIndex());
-    newBlock.setPreviousIndex(this); // Assuming 'prev' is an int, not a pointer
 }
 
 /**
@@ -122,17 +251,19 @@ void Block::divideBlock(Block& newBlock) {
  */
 // Removes a ZipCode record from the block
 bool Block::removeRecord(int zip) {
-    auto it = find_if(records.begin(), records.end(), [zip](const ZipCode& record) { return record.getNum() == zip; });
-    if (it != records.end()) {
-        int count = calculateZipSize(*it);
-        records.erase(it);
-        recCount--;
-        currentSize -= count;
-        calculateHighestZip();
-        active = recCount > 0;
-        return true;
-    }
-    return false;
+    int position = KeySearch::find(keys.data(), keys.size(), zip);
+    if (position < 0)
+        return false;
+
+    payloadSize -= recordSizes[position];
+    keys.erase(keys.begin() + position);
+    records.erase(records.begin() + position);
+    recordSizes.erase(recordSizes.begin() + position);
+    recCount--;
+    calculateHighestZip();
+    refreshSize();
+    active = recCount > 0;
+    return true;
 }
 
 /**
@@ -142,33 +273,67 @@ bool Block::removeRecord(int zip) {
  */
 // Calculates the highest ZIP code in the block
 int Block::calculateHighestZip() {
-    highestZip = records.empty() ? 0 : max_element(records.begin(), records.end(), 
-        [](const ZipCode& a, const ZipCode& b) { return a.getNum() < b.getNum(); })->getNum();
+    highestZip = keys.empty() ? 0 : keys.back();   // keys are kept sorted
     return highestZip;
 }
 
 /**
- * @brief Calculates the size of a ZipCode record.
+ * @brief Calculates the encoded size of a ZipCode record.
  * @param zipper A constant reference to the ZipCode object.
- * @return The size of the ZipCode record in bytes.
+ * @return The size of the ZipCode record in bytes, including its length prefix.
  */
 // Calculates the size of a ZipCode record
-int Block::calculateZipSize(const ZipCode& zipper) const {
-    ostringstream oss;
-    oss << zipper.getNum() << ',' << zipper.getCity() << ',' << zipper.getStateCode() << ','
-        << zipper.getCounty() << ',' << zipper.getLat() << ',' << zipper.getLon();
-    return oss.str().size();
+int Block::calculateZipSize(const ZipCode& zipper) {
+    return BlockRecordCodec::encodedSize(zipper);
+}
+
+/**
+ * @brief Chooses the encoding the block is written in.
+ * @param encoding The new encoding.
+ */
+void Block::setEncoding(BlockEncoding encoding) {
+    this->encoding = encoding;
+    refreshSize();
+}
+
+// Measures the compressed payload again when it is the one written
+void Block::refreshSize() {
+    if (encoding == COMPRESSED_BLOCK)
+        compressedSize = CompressedBlockCodec::encodedSize(records.data(), records.size());
+    updateSize();
+}
+
+/**
+ * @brief Calculates the encoded size of the whole block.
+ * @param count The record count written in the header.
+ * @param highest The highest zip written in the header.
+ * @param payload The encoded bytes of all records.
+ * @return The block size, which also appears in its own header.
+ * @details A compressed block's header carries a ",Z" field and a checksummed block
+ *          a ",K" field, both before the ';'.
+ */
+// Calculates the size of the block for the given contents
+int Block::calculateBlockSize(int count, int highest, int payload) const {
+    int fixed = NumberCodec::intLength(prev) + 1 + NumberCodec::intLength(next) + 1
+              + NumberCodec::intLength(count) + 1 + 1
+              + NumberCodec::intLength(highest) + 1 + payload
+              + (encoding == COMPRESSED_BLOCK ? 2 : 0)
+              + (checksummed ? ChecksumFieldSize : 0);
+    // the size field counts its own digits
+    int total = fixed + 1;
+    while (fixed + NumberCodec::intLength(total) != total) {
+        total = fixed + NumberCodec::intLength(total);
+    }
+    return total;
 }
 
 /**
- * @brief Calculates the size of the block header.
- * @return The size of the block header in bytes.
+ * @brief Finds where a zip code is or would be in the block.
+ * @param zip The zip code to look for.
+ * @return The position of the first record whose zip is not below zip.
  */
-// Calculates the size of the block header
-int Block::calculateHeaderSize() const {
-    ostringstream oss;
-    oss << prev << ',' << next << ',' << recCount << ',' << currentSize << ',' << highestZip << ';';
-    return oss.str().size();
+int Block::lowerBound(int zip) const {
+    return KeySearch::lowerBound(keys.data(), keys.size(), zip);
 }
 
 /**
@@ -178,7 +343,7 @@ int Block::calculateHeaderSize() const {
  */
 // Retrieves all ZipCode records in the block
 void Block::fetchRecords(vector<ZipCode>& recordsOut) const {
-    recordsOut = records;
+    recordsOut.assign(records.begin(), records.end());
 }
 
 /**
@@ -190,9 +355,9 @@ void Block::fetchRecords(vector<ZipCode>& recordsOut) const {
  */
 // Searches for a specific ZipCode in the block
 bool Block::searchZip(ZipCode& resultZip, int target) {
-    auto it = find_if(records.begin(), records.end(), [target](const ZipCode& record) { return record.getNum() == target; });
-    if (it != records.end()) {
-        resultZip = *it;
+    int position = KeySearch::find(keys.data(), keys.size(), target);
+    if (position >= 0) {
+        resultZip = records[position];   // the payload is only read on a hit
         return true;
     }
     return false;
@@ -6,6 +6,7 @@
 
 
 #include "zipCode.h"
+#include "Arena.h"
 #include <string>
 #include <vector>
 using namespace std;
@@ -14,16 +15,24 @@ using namespace std;
 #ifndef BLOCK
 #define BLOCK
 
-
+/**
+ * @brief How the records of a block are written after its ASCII header.
+ */
+enum BlockEncoding {
+    ASCII_BLOCK,       // length-indicated comma separated records
+    COMPRESSED_BLOCK   // CompressedBlockCodec payload, flagged by a Z field in the header
+};
 
 class Block {
 public:
      /**
      * @brief Default constructor.
+     * @param arena Arena the record storage is drawn from, or nullptr for the heap.
+     * @pre A supplied arena outlives the Block and is not rewound past it.
      * @post Creates an empty Block.
      */
     // Default constructor
-    Block();
+    explicit Block(Arena* arena = nullptr);
 
     /**
      * @brief Copy constructor.
@@ -41,13 +50,50 @@ public:
     // Merge constructor
     Block(Block& firstBlock, Block& secondBlock);
 
+    /**
+     * @brief Largest encoded size of a block, header included.
+     */
+    static const int Capacity = 512;
+
     /**
      * @brief Inserts a new ZipCode record into the Block.
      * @pre The Block should not exceed a certain size limit.
      * @post Adds a record to the Block, returns true if successful, false otherwise.
+     *       A record that does not fit is rejected and the Block is left as it was.
+     *       The size checked is the size in the Block's encoding.
      */
     // Inserts a new ZipCode record
-    bool insertRecord(ZipCode& newZip);
+    bool insertRecord(const ZipCode& newZip);
+
+    /**
+     * @brief Appends a record that sorts after every record already in the Block.
+     * @pre newZip's zip code is not below getMaximumZip(). Used when decoding a block,
+     *      whose records are stored in order and already fit.
+     * @post The record is added without a capacity check. getSize is not updated until
+     *       finishAppends is called.
+     */
+    void appendRecord(const ZipCode& newZip);
+
+    /**
+     * @brief Recomputes the size once after a run of appendRecord calls.
+     * @post getSize matches the records, so decoding a block measures it once rather
+     *       than once per record.
+     */
+    void finishAppends();
+
+    /**
+     * @brief Replaces the record with the same zip code as newZip.
+     * @post Returns false if the zip code is not in the Block or the new record does not
+     *       fit; the Block is then left as it was. The keys and highest zip do not change.
+     */
+    // Replaces a ZipCode record in place
+    bool replaceRecord(const ZipCode& newZip);
+
+    /**
+     * @brief Removes every record but keeps the links and the storage.
+     * @post The Block is empty and its size is the size of its header.
+     */
+    void clearRecords();
 
     /**
      * @brief Removes a ZipCode record from the Block.
@@ -91,36 +137,100 @@ public:
      */
     int getSize() const { return currentSize; };
 
+    /**
+     * @brief Get the encoding the block is written in.
+     */
+    BlockEncoding getEncoding() const { return encoding; };
+
+    /**
+     * @brief Check if the block is written with a CRC32C field in its header.
+     */
+    bool hasChecksum() const { return checksummed; };
+
     /**
      * @brief Get the highest ZIP code in the block.
      */
     int getMaximumZip() const { return highestZip; };
 
+    /**
+     * @brief Position of the first record whose zip is not below zip.
+     * @details Searches only the key array; a range scan starts reading records here.
+     */
+    int lowerBound(int zip) const;
+
+    /**
+     * @brief The zip keys of the records, in order, stored apart from the records.
+     */
+    const int* getKeys() const { return keys.data(); };
+
+    /**
+     * @brief In-place iteration over the records, in zip order.
+     */
+    const ZipCode* begin() const { return records.data(); };
+    const ZipCode* end() const { return records.data() + records.size(); };
+
     // Other methods
     void fetchRecords(vector<ZipCode>& recordsOut) const;
     bool searchZip(ZipCode& resultZip, int target);
 
     // Setters
     void setActiveState(bool state) { active = state; };
-    void setNextIndex(int next) { this->next = next; };
-    void setPreviousIndex(int prev) { this->prev = prev; };
+    void setNextIndex(int next) { this->next = next; updateSize(); };
+    void setPreviousIndex(int prev) { this->prev = prev; updateSize(); };
     void setRecordCount(int recCount) { this->recCount = recCount; };
     void setSize(int currentSize) { this->currentSize = currentSize; };
     void setMaximumZip(int highestZip) { this->highestZip = highestZip; };
 
+    /**
+     * @brief Chooses the encoding the block is written in.
+     * @post getSize() is the size of the block in that encoding, which may exceed
+     *       Capacity when switching to ASCII_BLOCK.
+     */
+    void setEncoding(BlockEncoding encoding);
+
+    /**
+     * @brief Chooses whether the block is written with a CRC32C field in its header.
+     * @post getSize() includes the field.
+     */
+    void setChecksum(bool checksummed) { this->checksummed = checksummed; updateSize(); };
+
+    /**
+     * @brief Bytes a ",K" checksum field adds to the header: the comma, K and eight hex digits.
+     */
+    static const int ChecksumFieldSize = 10;
+
     // Calculate the highest ZIP code
     int calculateHighestZip();
 
+    /**
+     * @brief Encoded size of a record inside a block, framing included.
+     */
+    static int calculateZipSize(const ZipCode& zipper);
+
 private:
-    // Calculate the size of a ZipCode record
-    int calculateZipSize(const ZipCode& zipper) const;
+    // Size of the whole block for the given header values and record bytes
+    int calculateBlockSize(int count, int highest, int payload) const;
 
-    // Calculate the size of the Block header
-    int calculateHeaderSize() const;
+    // Recompute currentSize after the header values or payload change
+    void updateSize() { currentSize = calculateBlockSize(recCount, highestZip, encodedPayload()); };
+
+    // Recompute the compressed payload after the records change, then the size
+    void refreshSize();
+
+    // Payload bytes in the current encoding
+    int encodedPayload() const { return encoding == COMPRESSED_BLOCK ? compressedSize : payloadSize; };
 
     // Member variables
     bool active;
     int prev, next;
     int highestZip, recCount, currentSize;
-    vector<ZipCode> records;
+    BlockEncoding encoding;
+    bool checksummed;
+    int payloadSize;                                   // ASCII bytes of all records
+    int compressedSize;                                // CompressedBlockCodec bytes of all records
+    vector<int, ArenaAllocator<int>> keys;             // zip of each record, searched without touching records
+    vector<ZipCode, ArenaAllocator<ZipCode>> records;
+    vector<short, ArenaAllocator<short>> recordSizes;  // encoded size of each record
 };
+
+#endif // BLOCK
@@ -4,6 +4,12 @@
  */
 
 #include "BlockBuffer.h"
+#include "NumberCodec.h"
+#include "RecordCodec.h"
+#include "CRC32C.h"
+#include <algorithm>
+#include <charconv>
+#include <unistd.h>
 
 /**
  * @brief Reads a block from a file based on its relative block number.
@@ -12,16 +18,31 @@
  */
 
 void BlockBuffer::read(ifstream& inFile, int RBN) {
-    unsigned long NBR = static_cast<unsigned long>(RBN) * 512;
-    int index = 0;
+    unsigned long NBR = static_cast<unsigned long>(RBN) * BUFSIZE;
+    inFile.clear();
     inFile.seekg(NBR);
-    while (!inFile.eof() && index != BUFSIZE) {
-        blockText.push_back(inFile.get());
-        index++;
-    }
+    // reuse the buffer's storage; after the first block no allocation happens here
+    blockText.resize(BUFSIZE);
+    inFile.read(&blockText[0], BUFSIZE);
+    blockText.resize(inFile.gcount());
     index = 0;
 }
 
+/**
+ * @brief Reads a block with a positioned read.
+ * @param fd The file descriptor to read from.
+ * @param RBN The relative block number indicating the specific block in the file.
+ * @return True if a whole block was read.
+ */
+bool BlockBuffer::read(int fd, int RBN) {
+    off_t NBR = static_cast<off_t>(RBN) * BUFSIZE;
+    blockText.resize(BUFSIZE);
+    ssize_t got = pread(fd, &blockText[0], BUFSIZE, NBR);
+    blockText.resize(got > 0 ? got : 0);
+    index = 0;
+    return got == BUFSIZE;
+}
+
 /**
  * @brief Converts a Block object into a text representation.
  * @param b The Block object to be converted into text.
@@ -29,19 +50,47 @@ void BlockBuffer::read(ifstream& inFile, int RBN) {
 // pack & storerecords
 void BlockBuffer::pack(Block& b) {
     Buffer_Record rec;
-    vector<ZipCode> records;
 
     string temp = writeHeader(b);
+    int start = blockText.size();
     blockText.append(temp);
 
-    
-    b.fetchRecords(records);
-    for (auto& record : records) {
-        rec.pack(record);
-        rec.write(blockText);
+    if (b.getEncoding() == COMPRESSED_BLOCK) {
+        CompressedBlockCodec::encode(b.begin(), b.getRecordCount(), blockText);
+    } else {
+        for (const ZipCode& record : b) {
+            rec.pack(const_cast<ZipCode&>(record));
+            rec.write(blockText);
+        }
+    }
+
+    if (b.hasChecksum()) {
+        // the checksum covers the header up to its own field, then the records
+        int field = start + temp.size() - 1 - Block::ChecksumFieldSize;
+        uint32_t crc = CRC32C::compute(blockText.data() + start, field - start);
+        crc = CRC32C::extend(crc, blockText.data() + start + temp.size(), blockText.size() - start - temp.size());
+        static const char hex[] = "0123456789abcdef";
+        for (int i = 0; i < 8; i++)
+            blockText[field + 2 + i] = hex[(crc >> (28 - 4 * i)) & 0xF];
     }
 }
 
+/**
+ * @brief Checks the parsed block against the checksum in its header.
+ * @return True if there is no checksum or it matches.
+ */
+bool BlockBuffer::checksumMatches() const {
+    if (checksumField < 0)
+        return true;
+    int headerEnd = checksumField + Block::ChecksumFieldSize + 1;
+    int end = min<int>(blockSize, blockText.size());
+    if (end < headerEnd)
+        return false;
+    uint32_t crc = CRC32C::compute(blockText.data(), checksumField);
+    crc = CRC32C::extend(crc, blockText.data() + headerEnd, end - headerEnd);
+    return crc == storedChecksum;
+}
+
 /**
  * @brief Writes the content of blockText to a file at a specific block position.
  * @param outfile The output file stream where the blockText will be written.
@@ -58,6 +107,20 @@ void BlockBuffer::write(ofstream& outfile, int RBN) {
     blockText = "";
 }
 
+/**
+ * @brief Writes blockText as a whole block with a positioned write.
+ * @param fd The file descriptor to write to.
+ * @param RBN The relative block number indicating the position in the file to write.
+ * @return True if the whole block was written.
+ */
+bool BlockBuffer::write(int fd, int RBN) {
+    off_t NBR = static_cast<off_t>(RBN) * BUFSIZE;
+    blockText.resize(BUFSIZE, ' ');
+    ssize_t put = pwrite(fd, blockText.data(), BUFSIZE, NBR);
+    blockText = "";
+    return put == BUFSIZE;
+}
+
 /**
  * @brief Parses the blockText into a Block object.
  * @param b An empty Block object that will be filled with data from blockText.
@@ -66,42 +129,59 @@ void BlockBuffer::unpack(Block& b) {
     readHeader(b);
     // Unpack blockText into Block object
     ZipCode tempZip;
-    string temp;
-    Buffer_Record rec;
-    int recSize;
-    int count;
     int numRecs = b.getRecordCount();
-    int recCounter = 0;
-    int tempCurrentSize = b.getSize();
+    int end = blockText.size();
 
-    b.setSize(0);
-
-    while (index != tempCurrentSize) {
-        if (recCounter == numRecs)
+    // records are stored in zip order and already fit, so they are appended as they are read
+    b.clearRecords();
+    if (encoding == COMPRESSED_BLOCK) {
+        ZipCodeView view;
+        reader.begin(blockText.data() + index, end - index, numRecs);
+        while (reader.next(view))
+            b.appendRecord(view.toZipCode());
+        numRecs = 0;
+    }
+    for (int recCounter = 0; recCounter < numRecs && index < end; recCounter++) {
+        int used = BlockRecordCodec::decode(blockText.data() + index, end - index, tempZip);
+        if (used == 0)
             break;
-
-        while (blockText[index] != ',') {
-            temp.push_back(blockText[index++]);
-        }
-        index++;
-        recSize = stoi(temp) - 3;
-        temp = "";
-        count = 0;
-        while (index != blockText.size() && count != recSize) {
-            temp.push_back(blockText[index++]);
-            count++;
-        }
-
-        rec.read(temp);
-        rec.unpack(tempZip);
-
-        b.insertRecord(tempZip);
-        recCounter++;
-        temp = "";
+        index += used;
+        b.appendRecord(tempZip);
     }
+    b.finishAppends();
     index = 0;
     blockText = "";
-    b.setSize(tempCurrentSize);
+}
+
+/**
+ * @brief Parses the header and positions at the first record.
+ * @param header The Block object that receives the header fields.
+ */
+void BlockBuffer::beginRecords(Block& header) {
+    readHeader(header);
+    remaining = header.getRecordCount();
+    if (encoding == COMPRESSED_BLOCK)
+        reader.begin(blockText.data() + index, blockText.size() - index, remaining);
+}
+
+/**
+ * @brief Decodes the next record in place.
+ * @param view The view that receives the record.
+ * @return True if a record was decoded.
+ */
+bool BlockBuffer::nextRecord(ZipCodeView& view) {
+    if (encoding == COMPRESSED_BLOCK)
+        return reader.next(view);
+    if (remaining <= 0 || static_cast<size_t>(index) >= blockText.size())
+        return false;
+    int used = BlockViewCodec::decode(blockText.data() + index, blockText.size() - index, view);
+    if (used == 0) {
+        remaining = 0;
+        return false;
+    }
+    index += used;
+    remaining--;
+    return true;
 }
 
 /**
@@ -110,44 +190,49 @@ void BlockBuffer::unpack(Block& b) {
  */
 // Parse header data from blockText
 void BlockBuffer::readHeader(Block& b) {
-    int headerSize;
+    int fields[5] = {};
+    const char* text = blockText.data();
+    int size = blockText.size();
     index = 0;
-    string temp;
 
-    for (index; blockText[index] != ','; index++) {
-        temp.push_back(blockText[index]);
+    int end = index;
+    for (int i = 0; i < 5 && index < size; i++) {
+        end = index;
+        while (end < size && text[end] != ',' && text[end] != ';')
+            end++;
+        NumberCodec::parseInt(text + index, text + end, fields[i]);
+        index = end + 1;
     }
-    index++;
-    b.setPreviousIndex(stoi(temp));
-    temp = "";
 
-    for (index; blockText[index] != ','; index++) {
-        temp.push_back(blockText[index]);
-    }
-    index++;
-    b.setNextIndex(stoi(temp));
-    temp = "";
-
-    for (index; blockText[index] != ','; index++) {
-        temp.push_back(blockText[index]);
-    }
-    index++;
-    b.setRecordCount(stoi(temp));
-    temp = "";
-
-    for (index; blockText[index] != ','; index++) {
-        temp.push_back(blockText[index]);
+    // optional fields, each tagged by its first letter, may follow before the ';'
+    encoding = ASCII_BLOCK;
+    checksumField = -1;
+    while (end < size && text[end] == ',') {
+        int start = end + 1;
+        end = start;
+        while (end < size && text[end] != ',' && text[end] != ';')
+            end++;
+        if (end - start == 1 && text[start] == 'Z') {
+            encoding = COMPRESSED_BLOCK;
+        } else if (end - start == Block::ChecksumFieldSize - 1 && text[start] == 'K') {
+            unsigned int crc = 0;
+            from_chars_result result = from_chars(text + start + 1, text + end, crc, 16);
+            if (result.ptr == text + end) {
+                checksumField = start - 1;
+                storedChecksum = crc;
+            }
+        }
+        index = end + 1;
     }
-    index++;
-    b.setSize(stoi(temp));
-    temp = "";
+    blockSize = fields[3];
 
-    for (index; blockText[index] != ';'; index++) {
-        temp.push_back(blockText[index]);
-    }
-    index++;
-    b.setMaximumZip(stoi(temp));
-    temp = "";
+    b.setEncoding(encoding);
+    b.setChecksum(checksumField >= 0);
+    b.setPreviousIndex(fields[0]);
+    b.setNextIndex(fields[1]);
+    b.setRecordCount(fields[2]);
+    b.setSize(fields[3]);
+    b.setMaximumZip(fields[4]);
 }
 
 /**
@@ -159,15 +244,19 @@ string BlockBuffer::writeHeader(Block& b) {
 // Create header string from Block object's attributes
     string header, temp;
 // Store block attributes as ASCII
-    header.append(to_string(b.getPreviousIndex()));
+    NumberCodec::appendInt(header, b.getPreviousIndex());
     header.push_back(',');
-    header.append(to_string(b.getNextIndex()));
+    NumberCodec::appendInt(header, b.getNextIndex());
     header.push_back(',');
-    header.append(to_string(b.getRecordCount()));
+    NumberCodec::appendInt(header, b.getRecordCount());
     header.push_back(',');
-    header.append(to_string(b.getSize()));
+    NumberCodec::appendInt(header, b.getSize());
     header.push_back(',');
-    header.append(to_string(b.getMaximumZip()));
+    NumberCodec::appendInt(header, b.getMaximumZip());
+    if (b.getEncoding() == COMPRESSED_BLOCK)
+        header.append(",Z");
+    if (b.hasChecksum())
+        header.append(",K00000000");   // filled in by pack once the records are written
     header.push_back(';');
     return header;
 }
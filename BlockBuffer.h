@@ -7,9 +7,11 @@
 #include <vector>
 #include <iostream>
 #include <string>
-#include "ZipCode.h"
+#include "zipCode.h"
 #include "Buffer_Record.h"
 #include "Block.h"
+#include "ZipCodeView.h"
+#include "CompressedBlockCodec.h"
 
 using namespace std;
 
@@ -20,7 +22,9 @@ public:
     /**
      * @brief Constructs a BlockBuffer with an empty text buffer.
      */
-    BlockBuffer() : blockText(""), index(0) {}
+    BlockBuffer()
+        : blockText(""), index(0), remaining(0), encoding(ASCII_BLOCK),
+          checksumField(-1), storedChecksum(0), blockSize(0) {}
 
     /**
      * @brief Reads a block from a file based on its relative block number.
@@ -30,6 +34,22 @@ public:
      */
     void read(ifstream& infile, int RBN);
 
+    /**
+     * @brief Reads a block with a positioned read, leaving the descriptor's offset alone.
+     * @param fd The file descriptor to read from.
+     * @param RBN The relative block number of the block.
+     * @return True if a whole block was read.
+     * @details Any number of threads may read the same descriptor this way at once.
+     */
+    bool read(int fd, int RBN);
+
+    /**
+     * @brief Loads a block image that was read earlier.
+     * @param image The block's text, as read from the file.
+     * @post The buffer is positioned as after read.
+     */
+    void assign(const string& image) { blockText = image; index = 0; };
+
     /**
      * @brief Converts a Block object into a text representation.
      * @param b The Block object to be converted into text.
@@ -45,6 +65,15 @@ public:
      */
     void write(ofstream& outfile, int RBN);
 
+    /**
+     * @brief Writes blockText as a whole block with a positioned write.
+     * @param fd The file descriptor to write to.
+     * @param RBN The relative block number of the block.
+     * @return True if the whole block was written.
+     * @post blockText is cleared, as with the stream version.
+     */
+    bool write(int fd, int RBN);
+
     /**
      * @brief Parses the blockText into a Block object.
      * @param b An empty Block object that will be filled with data from blockText.
@@ -52,11 +81,38 @@ public:
      */
     void unpack(Block& b);
 
+    /**
+     * @brief Parses only the header of blockText and positions at the first record.
+     * @param header A Block that receives the header fields; its records are left alone.
+     * @post nextRecord walks the records of the block without copying them.
+     */
+    void beginRecords(Block& header);
+
+    /**
+     * @brief Decodes the next record of the block as a view into blockText.
+     * @param view Receives the record. Its text fields stay valid until the buffer is
+     *             read, cleared or unpacked again.
+     * @return True if a record was decoded, false after the last one.
+     */
+    bool nextRecord(ZipCodeView& view);
+
+    /**
+     * @brief Check if the block last parsed by unpack or beginRecords has a checksum field.
+     */
+    bool hasChecksum() const { return checksumField >= 0; };
+
+    /**
+     * @brief Checks the block last parsed by beginRecords against its checksum.
+     * @pre Called before the buffer is cleared, read or unpacked again.
+     * @return True if the block has no checksum field or the checksum matches.
+     */
+    bool checksumMatches() const;
+
     /**
      * @brief Retrieves the content of the blockText buffer.
      * @return A string containing the content of blockText.
      */
-    string getText() const { return blockText; };
+    const string& getText() const { return blockText; };
 
     /**
      * @brief Clears the contents of the BlockBuffer.
@@ -64,6 +120,13 @@ public:
      */
     void clear() { blockText.clear(); index = 0; };
 
+    /**
+     * @brief Arena for Blocks decoded from this buffer.
+     * @details Callers build their working Blocks on it inside an ArenaScope so the
+     *          record storage of each operation is reused by the next one.
+     */
+    Arena* getArena() { return &arena; };
+
 private:
     /**
      * @brief Reads and parses the header data from a Block object.
@@ -82,6 +145,13 @@ private:
     string blockText;  // Text buffer for storing block content
     Block obj;         // Block object for temporary storage
     int index;         // Index used in reading and writing operations
+    int remaining;     // Records left for nextRecord
+    BlockEncoding encoding;              // Encoding of the block being read
+    CompressedBlockCodec::Reader reader; // Walks a compressed block for nextRecord
+    int checksumField;           // Position of the ",K" field, or -1 if there is none
+    unsigned int storedChecksum; // Checksum written in the header
+    int blockSize;               // Size field of the header
+    Arena arena;       // Record storage for Blocks unpacked from this buffer
 };
 
 #endif // BLOCKBUFFER
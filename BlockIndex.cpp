@@ -6,6 +6,7 @@ BlockIndex.cpp
 using namespace std;
 
 int BlockIndex::FindHighest() {
+    shared_lock<BlockLatch> guard(latch);
     int tempZip = 0;
     int tempRBN = 0;
 
@@ -26,6 +27,7 @@ int BlockIndex::FindHighest() {
 }
 
 int BlockIndex::Search(int zip) {
+    shared_lock<BlockLatch> guard(latch);
 
     if (index.size() == 0)
         return 0;
@@ -56,11 +58,18 @@ void BlockIndex::Add(Block& b, int r) {
     temp.zipCode = b.getMaximumZip();
     temp.RBN = r;
     temp.active = true;
-    Del(r);
+
+    unique_lock<BlockLatch> guard(latch);
+    eraseRBN(r);
     index.push_back(temp);
 }
 
 void BlockIndex::Del(int r) {
+    unique_lock<BlockLatch> guard(latch);
+    eraseRBN(r);
+}
+
+void BlockIndex::eraseRBN(int r) {
     if (index.size() == 0) {
         return;
     }
@@ -74,6 +83,7 @@ void BlockIndex::Del(int r) {
 
 void BlockIndex::ReadFromFile(string in) {
 
+    unique_lock<BlockLatch> guard(latch);
     ifstream iFile;
     iFile.open(in);
     char trash;
@@ -94,6 +104,7 @@ void BlockIndex::ReadFromFile(string in) {
 
 void BlockIndex::PrintToFile(string out) {
 
+    shared_lock<BlockLatch> guard(latch);
     ofstream oFile;
     oFile.open(out);
 
@@ -9,8 +9,11 @@
 #define BLOCKINDEX_H
 
 #include <fstream>
+#include <mutex>
+#include <shared_mutex>
 #include <vector>
 #include "Block.h"
+#include "BlockLatches.h"
 
 using namespace std;
 
@@ -25,6 +28,9 @@ class BlockIndex {
 private:
     int numBlocks, numAvail;
     vector<BlockIndexVariables> index;
+    mutable BlockLatch latch;    // searches share it, Add and Del take it alone
+
+    void eraseRBN(int r);
 
 public:
     /*
@@ -32,7 +38,7 @@ public:
     * @pre
     * @post
     */
-    BlockIndex() { 
+    BlockIndex() : numBlocks(0), numAvail(0) { 
         index.clear();
          }
 
@@ -86,6 +92,15 @@ public:
         return numBlocks;
          };
 
+    /*
+    * @brief Get entries function
+    * @post Returns a copy of every highest zip and RBN pair in the index, in no particular order
+    */
+    vector<BlockIndexVariables> GetEntries() const {
+        shared_lock<BlockLatch> guard(latch);
+        return index;
+        }
+
 };
 
 #endif // BLOCKINDEX_H
@@ -0,0 +1,48 @@
+/**
+ * @file BlockLatches.cpp
+ * @brief Implementation of the BlockLatches class.
+ */
+
+#include "BlockLatches.h"
+
+BlockLatch::BlockLatch() {
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    // without this a writer waits as long as any reader holds the latch
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&rwlock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+}
+
+BlockLatch::~BlockLatch() {
+    pthread_rwlock_destroy(&rwlock);
+}
+
+BlockLatches::BlockLatches() {
+    for (atomic<BlockLatch*>& chunk : chunks)
+        chunk.store(nullptr, memory_order_relaxed);
+}
+
+BlockLatches::~BlockLatches() {
+    for (atomic<BlockLatch*>& chunk : chunks)
+        delete[] chunk.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Gives the latch of a block.
+ * @param rbn The block's RBN.
+ * @return The latch, which lives as long as this table.
+ */
+BlockLatch& BlockLatches::get(int rbn) {
+    atomic<BlockLatch*>& slot = chunks[rbn >> ChunkBits];
+    BlockLatch* chunk = slot.load(memory_order_acquire);
+    if (chunk == nullptr) {
+        // two threads may race to create a chunk; the loser frees its copy
+        BlockLatch* fresh = new BlockLatch[ChunkSize];
+        if (slot.compare_exchange_strong(chunk, fresh, memory_order_acq_rel))
+            chunk = fresh;
+        else
+            delete[] fresh;
+    }
+    return chunk[rbn & (ChunkSize - 1)];
+}
@@ -0,0 +1,61 @@
+/**
+ * @file BlockLatches.h
+ * @brief One reader/writer latch per block of a blocked sequence set.
+ * @details Latches are allocated in chunks the first time a block in the chunk is latched,
+ *          and a latch never moves once it exists, so looking one up takes no lock.
+ *          Holders of more than one latch take them in list order, left to right along
+ *          the next links, which is what keeps readers and writers from deadlocking.
+ *          A latch lets a waiting writer in ahead of readers that arrive after it, since
+ *          readers coupling along the list would otherwise keep a busy block shared forever.
+ */
+
+#ifndef BLOCKLATCHES_H
+#define BLOCKLATCHES_H
+
+#include <atomic>
+#include <pthread.h>
+using namespace std;
+
+// A reader/writer latch that prefers writers; usable with shared_lock and unique_lock
+class BlockLatch {
+public:
+    BlockLatch();
+    ~BlockLatch();
+
+    BlockLatch(const BlockLatch&) = delete;
+    BlockLatch& operator=(const BlockLatch&) = delete;
+
+    void lock() { pthread_rwlock_wrlock(&rwlock); }
+    bool try_lock() { return pthread_rwlock_trywrlock(&rwlock) == 0; }
+    void unlock() { pthread_rwlock_unlock(&rwlock); }
+    void lock_shared() { pthread_rwlock_rdlock(&rwlock); }
+    bool try_lock_shared() { return pthread_rwlock_tryrdlock(&rwlock) == 0; }
+    void unlock_shared() { pthread_rwlock_unlock(&rwlock); }
+
+private:
+    pthread_rwlock_t rwlock;
+};
+
+class BlockLatches {
+public:
+    static const int ChunkBits = 10;
+    static const int ChunkSize = 1 << ChunkBits;
+    static const int MaxChunks = 4096;
+
+    BlockLatches();
+    ~BlockLatches();
+
+    BlockLatches(const BlockLatches&) = delete;
+    BlockLatches& operator=(const BlockLatches&) = delete;
+
+    /**
+     * @brief Gives the latch of a block.
+     * @pre 0 <= rbn < ChunkSize * MaxChunks.
+     */
+    BlockLatch& get(int rbn);
+
+private:
+    atomic<BlockLatch*> chunks[MaxChunks];
+};
+
+#endif // BLOCKLATCHES_H
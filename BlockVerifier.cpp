@@ -0,0 +1,182 @@
+/**
+ * @file BlockVerifier.cpp
+ * @brief Implementation of the BlockVerifier class.
+ * @details The per-block checks run on a ParallelScan. Each worker records a handful of
+ *          integers per block in a table indexed by RBN, so the link, reachability and
+ *          index checks afterwards are linear passes over memory rather than the file.
+ */
+
+#include "BlockVerifier.h"
+#include "ParallelScan.h"
+
+// Tallies and problems of one chunk of blocks
+struct ChunkCheck {
+    int blocks = 0;
+    int active = 0;
+    int checksummed = 0;
+    long records = 0;
+    vector<string> problems;
+};
+
+static string blockProblem(int rbn, const char* text) {
+    return "RBN " + to_string(rbn) + ": " + text;
+}
+
+void BlockVerifier::addProblem(VerifyReport& report, string problem) {
+    if (report.problems.size() < MaxProblems)
+        report.problems.push_back(move(problem));
+    report.problemCount++;
+}
+
+/**
+ * @brief Checks the file.
+ * @return The counts and problems found.
+ */
+VerifyReport BlockVerifier::run() {
+    VerifyReport report;
+
+    ifstream file(fileName, ios::binary | ios::ate);
+    if (!file.is_open()) {
+        addProblem(report, "cannot open " + fileName);
+        return report;
+    }
+    int lastRBN = static_cast<long>(file.tellg()) / BUFSIZE - 1;   // RBN 0 holds the file header
+    file.close();
+    if (lastRBN < 1)
+        return report;
+
+    // each RBN is visited by exactly one worker, so the workers fill this without locking
+    vector<BlockFacts> facts(lastRBN + 1);
+
+    auto visit = [&facts](int rbn, BlockBuffer& buffer, ChunkCheck& check) {
+        check.blocks++;
+        if (buffer.getText().size() < BUFSIZE) {
+            check.problems.push_back(blockProblem(rbn, "block is truncated"));
+            if (buffer.getText().empty())
+                return;
+        }
+
+        Block header;
+        ZipCodeView record;
+        buffer.beginRecords(header);
+        if (buffer.hasChecksum()) {
+            check.checksummed++;
+            if (!buffer.checksumMatches())
+                check.problems.push_back(blockProblem(rbn, "checksum does not match"));
+        }
+
+        BlockFacts& fact = facts[rbn];
+        fact.prev = header.getPreviousIndex();
+        fact.next = header.getNextIndex();
+        fact.highest = header.getMaximumZip();
+        fact.active = header.getRecordCount() > 0;
+        if (!fact.active)
+            return;
+        check.active++;
+
+        int count = 0, last = 0;
+        while (buffer.nextRecord(record)) {
+            if (count == 0)
+                fact.lowest = record.getNum();
+            else if (record.getNum() <= last)
+                check.problems.push_back(blockProblem(rbn, "keys are out of order"));
+            last = record.getNum();
+            count++;
+        }
+        check.records += count;
+        if (count != header.getRecordCount())
+            check.problems.push_back(blockProblem(rbn, "record count does not match the records"));
+        else if (last != header.getMaximumZip())
+            check.problems.push_back(blockProblem(rbn, "highest zip is not the last key"));
+    };
+
+    auto emit = [&report](ChunkCheck& check) {
+        report.blocksChecked += check.blocks;
+        report.activeBlocks += check.active;
+        report.checksummedBlocks += check.checksummed;
+        report.records += check.records;
+        for (string& problem : check.problems)
+            addProblem(report, move(problem));
+    };
+
+    ParallelScan scan(fileName, 1, lastRBN, threads);
+    if (!scan.run<ChunkCheck>(visit, emit))
+        addProblem(report, "cannot read " + fileName);
+
+    checkLinks(facts, report);
+    checkReachability(facts, report);
+    if (index != nullptr)
+        checkIndex(facts, report);
+    return report;
+}
+
+// Every link must be returned by the block it names, and keys must ascend across it
+void BlockVerifier::checkLinks(const vector<BlockFacts>& facts, VerifyReport& report) const {
+    int lastRBN = facts.size() - 1;
+    for (int rbn = 1; rbn <= lastRBN; rbn++) {
+        const BlockFacts& fact = facts[rbn];
+        if (!fact.active)
+            continue;
+
+        if (fact.next != 0) {
+            if (fact.next < 1 || fact.next > lastRBN || !facts[fact.next].active) {
+                addProblem(report, blockProblem(rbn, "next link names a block that is not active"));
+            } else {
+                if (facts[fact.next].prev != rbn)
+                    addProblem(report, blockProblem(rbn, "next block does not link back"));
+                if (facts[fact.next].lowest <= fact.highest)
+                    addProblem(report, blockProblem(rbn, "next block's keys do not follow this block's"));
+            }
+        }
+        if (fact.prev != 0) {
+            if (fact.prev < 1 || fact.prev > lastRBN || !facts[fact.prev].active)
+                addProblem(report, blockProblem(rbn, "previous link names a block that is not active"));
+            else if (facts[fact.prev].next != rbn)
+                addProblem(report, blockProblem(rbn, "previous block does not link forward"));
+        }
+    }
+}
+
+// Following next links from the head must reach every active block exactly once
+void BlockVerifier::checkReachability(const vector<BlockFacts>& facts, VerifyReport& report) const {
+    int lastRBN = facts.size() - 1;
+    vector<char> reached(lastRBN + 1, 0);
+
+    int rbn = firstRBN;
+    if (rbn >= 1 && rbn <= lastRBN && facts[rbn].active && facts[rbn].prev != 0)
+        addProblem(report, blockProblem(rbn, "list head has a previous link"));
+    while (rbn >= 1 && rbn <= lastRBN && facts[rbn].active) {
+        if (reached[rbn]) {
+            addProblem(report, blockProblem(rbn, "next links form a cycle"));
+            break;
+        }
+        reached[rbn] = 1;
+        rbn = facts[rbn].next;
+    }
+
+    for (int i = 1; i <= lastRBN; i++) {
+        if (facts[i].active && !reached[i])
+            addProblem(report, blockProblem(i, "active block is not reachable from the list head"));
+    }
+}
+
+// Each index entry must name an active block with the same highest zip
+void BlockVerifier::checkIndex(const vector<BlockFacts>& facts, VerifyReport& report) const {
+    int lastRBN = facts.size() - 1;
+    vector<char> indexed(lastRBN + 1, 0);
+
+    for (const BlockIndexVariables& entry : index->GetEntries()) {
+        if (entry.RBN < 1 || entry.RBN > lastRBN || !facts[entry.RBN].active) {
+            addProblem(report, blockProblem(entry.RBN, "index entry names a block that is not active"));
+            continue;
+        }
+        indexed[entry.RBN] = 1;
+        if (facts[entry.RBN].highest != entry.zipCode)
+            addProblem(report, blockProblem(entry.RBN, "highest zip differs from the block index"));
+    }
+
+    for (int i = 1; i <= lastRBN; i++) {
+        if (facts[i].active && !indexed[i])
+            addProblem(report, blockProblem(i, "active block is missing from the block index"));
+    }
+}
@@ -0,0 +1,75 @@
+/**
+ * @file BlockVerifier.h
+ * @brief Integrity check of a blocked sequence set file.
+ */
+
+#ifndef BLOCKVERIFIER_H
+#define BLOCKVERIFIER_H
+
+#include <string>
+#include <vector>
+#include "BlockIndex.h"
+using namespace std;
+
+/**
+ * @brief Outcome of a BlockVerifier run.
+ */
+struct VerifyReport {
+    int blocksChecked = 0;
+    int activeBlocks = 0;
+    int checksummedBlocks = 0;
+    long records = 0;
+    int problemCount = 0;
+    vector<string> problems;    // the first BlockVerifier::MaxProblems problems, in RBN order
+
+    bool ok() const { return problemCount == 0; }
+};
+
+class BlockVerifier {
+public:
+    /**
+     * @brief Problems kept in a report; later ones are only counted.
+     */
+    static const int MaxProblems = 100;
+
+    /**
+     * @brief Prepares a check of a file.
+     * @param fileName The blocked sequence set file.
+     * @param firstRBN The head of the active list.
+     * @param index The block index to check the file against, or nullptr to skip that check.
+     * @param threads Worker count for the block pass, or 0 for one per hardware thread.
+     */
+    BlockVerifier(const string& fileName, int firstRBN = 1, const BlockIndex* index = nullptr, int threads = 0)
+        : fileName(fileName), firstRBN(firstRBN), index(index), threads(threads) {}
+
+    /**
+     * @brief Checks the file.
+     * @post Every block is read once, in parallel, to check its checksum, its record
+     *       count, that its keys ascend and that its highest zip is its last key. The
+     *       links are then checked for prev/next symmetry and key order across blocks,
+     *       every active block must be reachable from firstRBN, and every index entry
+     *       must name an active block with that highest zip.
+     */
+    VerifyReport run();
+
+private:
+    // What the link and index checks need to know about one block
+    struct BlockFacts {
+        int prev = 0, next = 0;
+        int lowest = 0, highest = 0;
+        bool active = false;
+    };
+
+    static void addProblem(VerifyReport& report, string problem);
+
+    void checkLinks(const vector<BlockFacts>& facts, VerifyReport& report) const;
+    void checkReachability(const vector<BlockFacts>& facts, VerifyReport& report) const;
+    void checkIndex(const vector<BlockFacts>& facts, VerifyReport& report) const;
+
+    string fileName;
+    int firstRBN;
+    const BlockIndex* index;
+    int threads;
+};
+
+#endif // BLOCKVERIFIER_H
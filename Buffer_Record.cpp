@@ -7,6 +7,7 @@
  */
 
 #include "Buffer_Record.h"
+#include "RecordCodec.h"
 
 /**
  * @brief Default constructor for Buffer_Record.
@@ -14,22 +15,7 @@
  */
 // Packs a ZipCode object into the buffer
 void Buffer_Record::pack(ZipCode& z) {
-    std::string temp;
-
-    temp.push_back(',');
-    temp.append(std::to_string(z.getNum()));
-    temp.push_back(',');
-    temp.append(z.getCity());
-    temp.push_back(',');
-    temp.append(z.getStateCode());
-    temp.push_back(',');
-    temp.append(z.getCounty());
-    temp.push_back(',');
-    temp.append(std::to_string(z.getLat()));
-    temp.push_back(',');
-    temp.append(std::to_string(z.getLon()));
-    buf.append(std::to_string(temp.size() + 2));
-    buf.append(temp);
+    BlockRecordCodec::encode(z, buf);
 }
 
 /**
@@ -61,46 +47,13 @@ void Buffer_Record::write(std::string& blockText) {
  */
 // Unpacks the buffer into a ZipCode object
 bool Buffer_Record::unpack(ZipCode& z) {
-    std::string temp;
-    int size = buf.size();
-    temp = "";
+    size = buf.size();
     index = 0;
 
-    int fieldNumber = 1;
-
-    if (index != size) { // execute only when buf is not empty
-        for (int i = 0; i < size && index < buf.size() + 1; i++) {
-            if (buf[index] != delim) {
-                temp.push_back(buf[index]);
-                if (buf[index + 1] == delim || index + 1 == size) {
-                    if (fieldNumber == 1) {
-                        z.setNum(std::stoi(temp));
-                    } else if (fieldNumber == 2) {
-                        z.setCity(temp);
-                    } else if (fieldNumber == 3) {
-                        z.setStateCode(temp);
-                    } else if (fieldNumber == 4) {
-                        z.setCounty(temp);
-                    } else if (fieldNumber == 5) {
-                        z.setLat(std::stof(temp));
-                    } else {
-                        z.setLon(std::stof(temp));
-                    }
-                    fieldNumber++;
-                    temp = "";
-                }
-            }
-            index++;
-        }
-        return true;
-    }
+    if (size == 0) // execute only when buf is not empty
+        return false;
 
-    return false;
+    BlockRecordCodec::decodeBody(buf.data(), size, z);
+    index = size;
+    return true;
 }
-/**
- * @brief Clears the contents of the buffer.
- * @post The buffer is cleared and reset.
- */
-void Buffer_Record::clear() {
-    // Implementation
-}
\ No newline at end of file
@@ -7,7 +7,7 @@
 #include <iostream>
 #include <string>
 #include <fstream>
-#include "ZipCode.h"
+#include "zipCode.h"
 
 class Buffer_Record {
 public:
@@ -0,0 +1,60 @@
+/**
+ * @file CRC32C.cpp
+ * @brief Implementation of the CRC32C class.
+ * @details With SSE4.2 the crc32 instruction consumes eight bytes at a time. Otherwise
+ *          a 256-entry table for the reflected polynomial 0x82F63B78 is used a byte at a
+ *          time. Both give the same checksums.
+ */
+
+#include "CRC32C.h"
+#include <cstring>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+#if !defined(__SSE4_2__)
+// Table for the byte-at-a-time fallback, filled on first use
+static const uint32_t* crcTable() {
+    static uint32_t table[256];
+    static bool filled = [] {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++)
+                crc = (crc >> 1) ^ (0x82F63B78 & (0U - (crc & 1)));
+            table[i] = crc;
+        }
+        return true;
+    }();
+    (void)filled;
+    return table;
+}
+#endif
+
+/**
+ * @brief Continues a checksum with more bytes.
+ * @param crc The checksum so far, or 0.
+ * @param data The bytes to add.
+ * @param size The number of bytes.
+ * @return The updated checksum.
+ */
+uint32_t CRC32C::extend(uint32_t crc, const void* data, size_t size) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+#if defined(__SSE4_2__)
+#if defined(__x86_64__)
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc = static_cast<uint32_t>(_mm_crc32_u64(crc, word));
+    }
+#endif
+    for (; size > 0; p++, size--)
+        crc = _mm_crc32_u8(crc, *p);
+#else
+    const uint32_t* table = crcTable();
+    for (; size > 0; p++, size--)
+        crc = table[(crc ^ *p) & 0xFF] ^ (crc >> 8);
+#endif
+    return ~crc;
+}
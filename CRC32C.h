@@ -0,0 +1,27 @@
+/**
+ * @file CRC32C.h
+ * @brief CRC-32C (Castagnoli) checksums for block contents.
+ */
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+
+class CRC32C {
+public:
+    /**
+     * @brief Checksum of a byte range.
+     */
+    static uint32_t compute(const void* data, size_t size) { return extend(0, data, size); }
+
+    /**
+     * @brief Continues a checksum with more bytes.
+     * @pre crc is the checksum of the bytes before data, or 0 to start.
+     * @post Returns the checksum of all the bytes so far.
+     */
+    static uint32_t extend(uint32_t crc, const void* data, size_t size);
+};
+
+#endif // CRC32C_H
@@ -0,0 +1,211 @@
+/**
+ * @file CompressedBlockCodec.cpp
+ * @brief Implementation of the CompressedBlockCodec class.
+ */
+
+#include "CompressedBlockCodec.h"
+
+// Finds text in a dictionary, adding it if it is new
+static int dictionaryIndex(vector<string_view>& entries, string_view text) {
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i] == text)
+            return i;
+    }
+    entries.push_back(text);
+    return entries.size() - 1;
+}
+
+void CompressedBlockCodec::buildDictionaries(const ZipCode* records, int count,
+                                             vector<string_view>& states, vector<string_view>& counties,
+                                             vector<unsigned char>& stateIndex, vector<unsigned short>& countyIndex) {
+    states.clear();
+    counties.clear();
+    stateIndex.resize(count);
+    countyIndex.resize(count);
+    for (int i = 0; i < count; i++) {
+        stateIndex[i] = dictionaryIndex(states, records[i].getStateCode());
+        countyIndex[i] = dictionaryIndex(counties, records[i].getCounty());
+    }
+}
+
+/**
+ * @brief Number of bytes encode would write.
+ * @param records The records, in zip order.
+ * @param count The number of records.
+ * @return The payload size.
+ */
+int CompressedBlockCodec::encodedSize(const ZipCode* records, int count) {
+    if (count == 0)
+        return 0;
+
+    // scratch space is kept between calls; a block is measured on every insert
+    thread_local vector<string_view> states, counties;
+    thread_local vector<unsigned char> stateIndex;
+    thread_local vector<unsigned short> countyIndex;
+    buildDictionaries(records, count, states, counties, stateIndex, countyIndex);
+
+    int minZip = records[0].getNum();
+    int size = varintLength(minZip) + varintLength(states.size()) + varintLength(counties.size());
+    for (string_view state : states)
+        size += varintLength(state.size()) + state.size();
+    for (string_view county : counties)
+        size += varintLength(county.size()) + county.size();
+
+    int lat = 0, lon = 0;
+    for (int i = 0; i < count; i++) {
+        const ZipCode& r = records[i];
+        size += varintLength(r.getNum() - minZip) + varintLength(stateIndex[i]) + varintLength(countyIndex[i])
+              + varintLength(r.getCity().size()) + r.getCity().size()
+              + varintLength(zigzag(r.getLatMicro() - lat)) + varintLength(zigzag(r.getLonMicro() - lon));
+        lat = r.getLatMicro();
+        lon = r.getLonMicro();
+    }
+    return size;
+}
+
+/**
+ * @brief Appends the encoded records to out.
+ * @param records The records, in zip order.
+ * @param count The number of records.
+ * @param out The block text to append to.
+ */
+void CompressedBlockCodec::encode(const ZipCode* records, int count, string& out) {
+    if (count == 0)
+        return;
+
+    thread_local vector<string_view> states, counties;
+    thread_local vector<unsigned char> stateIndex;
+    thread_local vector<unsigned short> countyIndex;
+    buildDictionaries(records, count, states, counties, stateIndex, countyIndex);
+
+    int minZip = records[0].getNum();
+    appendVarint(out, minZip);
+    appendVarint(out, states.size());
+    for (string_view state : states) {
+        appendVarint(out, state.size());
+        out.append(state);
+    }
+    appendVarint(out, counties.size());
+    for (string_view county : counties) {
+        appendVarint(out, county.size());
+        out.append(county);
+    }
+
+    int lat = 0, lon = 0;
+    for (int i = 0; i < count; i++) {
+        const ZipCode& r = records[i];
+        appendVarint(out, r.getNum() - minZip);
+        appendVarint(out, stateIndex[i]);
+        appendVarint(out, countyIndex[i]);
+        appendVarint(out, r.getCity().size());
+        out.append(r.getCity());
+        appendVarint(out, zigzag(r.getLatMicro() - lat));
+        appendVarint(out, zigzag(r.getLonMicro() - lon));
+        lat = r.getLatMicro();
+        lon = r.getLonMicro();
+    }
+}
+
+int CompressedBlockCodec::varintLength(unsigned int value) {
+    int length = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        length++;
+    }
+    return length;
+}
+
+void CompressedBlockCodec::appendVarint(string& out, unsigned int value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+/**
+ * @brief Starts reading a payload and loads its dictionaries.
+ * @param data The first byte of the payload.
+ * @param size The bytes available.
+ * @param count The record count from the block header.
+ * @return False if the dictionaries could not be read.
+ */
+bool CompressedBlockCodec::Reader::begin(const char* data, int size, int count) {
+    this->data = data;
+    this->size = size;
+    position = 0;
+    remaining = 0;
+    lat = 0;
+    lon = 0;
+    if (count <= 0)
+        return true;
+
+    unsigned int zip;
+    if (!readVarint(zip) || !readDictionary(states) || !readDictionary(counties))
+        return false;
+    minZip = zip;
+    remaining = count;
+    return true;
+}
+
+/**
+ * @brief Decodes the next record.
+ * @param view Receives the record.
+ * @return True if a record was decoded.
+ */
+bool CompressedBlockCodec::Reader::next(ZipCodeView& view) {
+    if (remaining <= 0)
+        return false;
+
+    unsigned int zip, state, county, dLat, dLon;
+    string_view city;
+    if (!readVarint(zip) || !readVarint(state) || !readVarint(county) || !readText(city)
+        || !readVarint(dLat) || !readVarint(dLon)
+        || state >= states.size() || county >= counties.size()) {
+        remaining = 0;
+        return false;
+    }
+
+    lat += unzigzag(dLat);
+    lon += unzigzag(dLon);
+    view.setNum(minZip + zip);
+    view.setCity(city);
+    view.setStateCode(states[state]);
+    view.setCounty(counties[county]);
+    view.setLatMicro(lat);
+    view.setLonMicro(lon);
+    remaining--;
+    return true;
+}
+
+bool CompressedBlockCodec::Reader::readVarint(unsigned int& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && position < size; shift += 7) {
+        unsigned char byte = data[position++];
+        value |= static_cast<unsigned int>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool CompressedBlockCodec::Reader::readText(string_view& text) {
+    unsigned int length;
+    if (!readVarint(length) || length > static_cast<unsigned int>(size - position))
+        return false;
+    text = string_view(data + position, length);
+    position += length;
+    return true;
+}
+
+bool CompressedBlockCodec::Reader::readDictionary(vector<string_view>& entries) {
+    unsigned int count;
+    if (!readVarint(count) || count > static_cast<unsigned int>(size - position))
+        return false;
+    entries.resize(count);
+    for (unsigned int i = 0; i < count; i++) {
+        if (!readText(entries[i]))
+            return false;
+    }
+    return true;
+}
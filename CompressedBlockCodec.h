@@ -0,0 +1,93 @@
+/**
+ * @file CompressedBlockCodec.h
+ * @brief Compact binary encoding for the records of a block.
+ * @details The records of a compressed block follow its ASCII header as
+ *
+ *          minZip
+ *          stateCount  { length bytes }...
+ *          countyCount { length bytes }...
+ *          { zip-minZip  stateIndex  countyIndex  cityLength cityBytes  dLat  dLon }...
+ *
+ *          Every number is a base-128 varint. States and counties are written once per
+ *          block in order of first use and referenced by index. Coordinates are
+ *          micro-degrees, each written as the zigzag-coded difference from the record
+ *          before it, so neighbouring zips cost one or two bytes per coordinate.
+ */
+
+#ifndef COMPRESSEDBLOCKCODEC_H
+#define COMPRESSEDBLOCKCODEC_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "zipCode.h"
+#include "ZipCodeView.h"
+using namespace std;
+
+class CompressedBlockCodec {
+public:
+    /**
+     * @brief Number of bytes encode would write for the records.
+     * @pre records holds count records in zip order.
+     * @post Returns the exact payload size; nothing is written.
+     */
+    static int encodedSize(const ZipCode* records, int count);
+
+    /**
+     * @brief Appends the encoded records to out.
+     * @pre records holds count records in zip order.
+     * @post Exactly encodedSize(records, count) bytes are appended.
+     */
+    static void encode(const ZipCode* records, int count, string& out);
+
+    /**
+     * @brief Decodes the records of a compressed block in place.
+     * @details The dictionaries are views into the block text, so walking a block
+     *          copies no strings and, once the reader has warmed up, allocates nothing.
+     */
+    class Reader {
+    public:
+        Reader() : data(nullptr), size(0), position(0), remaining(0), minZip(0), lat(0), lon(0) {}
+
+        /**
+         * @brief Starts reading a payload.
+         * @pre [data, data + size) holds a payload written by encode and outlives the reader.
+         * @post Returns false if the dictionaries are damaged; next then returns false.
+         */
+        bool begin(const char* data, int size, int count);
+
+        /**
+         * @brief Decodes the next record.
+         * @param view Receives the record; its text points into the payload.
+         * @return True if a record was decoded, false after the last one or on damage.
+         */
+        bool next(ZipCodeView& view);
+
+    private:
+        bool readVarint(unsigned int& value);
+        bool readText(string_view& text);
+        bool readDictionary(vector<string_view>& entries);
+
+        const char* data;
+        int size;
+        int position;
+        int remaining;
+        int minZip;
+        int lat, lon;
+        vector<string_view> states;
+        vector<string_view> counties;
+    };
+
+private:
+    // Builds the state and county dictionaries of the records, in order of first use
+    static void buildDictionaries(const ZipCode* records, int count,
+                                  vector<string_view>& states, vector<string_view>& counties,
+                                  vector<unsigned char>& stateIndex, vector<unsigned short>& countyIndex);
+
+    static int varintLength(unsigned int value);
+    static void appendVarint(string& out, unsigned int value);
+    static unsigned int zigzag(int value) { return (static_cast<unsigned int>(value) << 1) ^ static_cast<unsigned int>(value >> 31); }
+    static int unzigzag(unsigned int value) { return static_cast<int>(value >> 1) ^ -static_cast<int>(value & 1); }
+};
+
+#endif // COMPRESSEDBLOCKCODEC_H
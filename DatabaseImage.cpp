@@ -0,0 +1,296 @@
+/**
+ * @file DatabaseImage.cpp
+ * @brief Implementation of the DatabaseImage class.
+ */
+
+#include "DatabaseImage.h"
+#include "KeySearch.h"
+#include "LengthBuffer.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+static const char ImageMagic[8] = {'Z', 'I', 'P', 'I', 'M', 'A', 'G', 'E'};
+
+// Rounds a section start up to 8 bytes
+static uint64_t align8(uint64_t offset) {
+    return (offset + 7) & ~uint64_t(7);
+}
+
+DatabaseImage::DatabaseImage()
+    : header(nullptr), keys(nullptr), locations(nullptr), records(nullptr), fences(nullptr),
+      stringIndex(nullptr), stringBytes(nullptr), states(nullptr), mapping(nullptr), mappingSize(0) {}
+
+DatabaseImage::~DatabaseImage() {
+    close();
+}
+
+/**
+ * @brief Writes an image.
+ * @param path The image file to create.
+ * @param index Zip and data file offset of each record, in zip order.
+ * @param records The records, parallel to index.
+ * @param blocks The block index, or nullptr.
+ * @param stats The per-state aggregates.
+ * @param sourceStamp The stamp of the files the records were read from, or 0.
+ * @return True if the image was written.
+ */
+bool DatabaseImage::write(const string& path, const vector<IndexElement>& index, const vector<ZipCode>& records,
+                          const BlockIndex* blocks, const StateStats& stats, uint64_t sourceStamp) {
+    // every distinct string once, in order of first use
+    vector<string_view> strings;
+    unordered_map<string_view, uint32_t> ids;
+    auto intern = [&](string_view text) -> uint32_t {
+        auto it = ids.find(text);
+        if (it != ids.end())
+            return it->second;
+        ids.emplace(text, strings.size());
+        strings.push_back(text);
+        return strings.size() - 1;
+    };
+
+    vector<Record> packed(records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        const ZipCode& zip = records[i];
+        packed[i].latMicro = zip.getLatMicro();
+        packed[i].lonMicro = zip.getLonMicro();
+        packed[i].city = intern(zip.getCity());
+        packed[i].county = intern(zip.getCounty());
+        packed[i].state = intern(zip.getStateCode());
+    }
+
+    vector<Fence> fenceList;
+    if (blocks != nullptr) {
+        for (const BlockIndexVariables& entry : blocks->GetEntries()) {
+            if (entry.active)
+                fenceList.push_back(Fence{entry.zipCode, entry.RBN});
+        }
+        sort(fenceList.begin(), fenceList.end(),
+             [](const Fence& a, const Fence& b) { return a.highestZip < b.highestZip; });
+    }
+
+    vector<uint32_t> stringOffsets(strings.size() + 1, 0);
+    for (size_t i = 0; i < strings.size(); i++)
+        stringOffsets[i + 1] = stringOffsets[i] + strings[i].size();
+
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, ImageMagic, sizeof(h.magic));
+    h.version = Version;
+    h.headerSize = sizeof(Header);
+    h.recordCount = records.size();
+    h.blockCount = fenceList.size();
+    h.stringCount = strings.size();
+    h.stateCount = StateCodes::NumStates;
+    h.keysOffset = align8(sizeof(Header));
+    h.locationsOffset = align8(h.keysOffset + sizeof(int32_t) * h.recordCount);
+    h.recordsOffset = align8(h.locationsOffset + sizeof(uint64_t) * h.recordCount);
+    h.fencesOffset = align8(h.recordsOffset + sizeof(Record) * h.recordCount);
+    h.stringIndexOffset = align8(h.fencesOffset + sizeof(Fence) * h.blockCount);
+    h.stringBytesOffset = align8(h.stringIndexOffset + sizeof(uint32_t) * stringOffsets.size());
+    h.statesOffset = align8(h.stringBytesOffset + stringOffsets.back());
+    h.imageSize = h.statesOffset + sizeof(StateSummary) * h.stateCount;
+    h.sourceStamp = sourceStamp;
+
+    string image(h.imageSize, '\0');
+    char* base = &image[0];
+    memcpy(base, &h, sizeof(h));
+    for (size_t i = 0; i < index.size(); i++) {
+        int32_t key = index[i].zip;
+        uint64_t location = index[i].offset;
+        memcpy(base + h.keysOffset + i * sizeof(key), &key, sizeof(key));
+        memcpy(base + h.locationsOffset + i * sizeof(location), &location, sizeof(location));
+    }
+    if (!packed.empty())
+        memcpy(base + h.recordsOffset, packed.data(), sizeof(Record) * packed.size());
+    if (!fenceList.empty())
+        memcpy(base + h.fencesOffset, fenceList.data(), sizeof(Fence) * fenceList.size());
+    memcpy(base + h.stringIndexOffset, stringOffsets.data(), sizeof(uint32_t) * stringOffsets.size());
+    for (size_t i = 0; i < strings.size(); i++)
+        memcpy(base + h.stringBytesOffset + stringOffsets[i], strings[i].data(), strings[i].size());
+    for (int i = 0; i < StateCodes::NumStates; i++)
+        memcpy(base + h.statesOffset + i * sizeof(StateSummary), &stats.get(i), sizeof(StateSummary));
+
+    // written under a temporary name and renamed, so readers never map a partial image
+    string temporary = path + ".tmp";
+    ofstream out(temporary, ios::binary | ios::trunc);
+    out.write(image.data(), image.size());
+    out.close();
+    if (!out)
+        return false;
+    return rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+/**
+ * @brief Writes an image from the length-indicated data file and its primary index.
+ * @param path The image file to create.
+ * @param indexFileName The primary index file.
+ * @param dataFileName The length-indicated data file.
+ * @param blocks The block index, or nullptr.
+ * @return True if the image was written.
+ */
+bool DatabaseImage::build(const string& path, const string& indexFileName, const string& dataFileName,
+                          const BlockIndex* blocks) {
+    // taken before reading, so a write that lands meanwhile leaves the image stale
+    uint64_t stamp = sourceStamp(indexFileName, dataFileName);
+    PrimaryIndex primary(indexFileName, dataFileName);
+    vector<IndexElement> index;
+    primary.getIndex(index);
+
+    fstream data(dataFileName);
+    if (!data.is_open())
+        return false;
+
+    LengthBuffer buffer;
+    ZipCode zip;
+    vector<ZipCode> records;
+    StateStats stats;
+    records.reserve(index.size());
+    for (const IndexElement& element : index) {
+        if (!buffer.read(data, element.offset) || !buffer.unpack(zip))
+            return false;
+        records.push_back(zip);
+        stats.add(zip);
+    }
+    return write(path, index, records, blocks, stats, stamp);
+}
+
+/**
+ * @brief Fingerprint of the sizes and modification times of an index and data file.
+ * @param indexFileName The primary index file.
+ * @param dataFileName The length-indicated data file.
+ * @return The stamp, or 0 if either file is missing.
+ */
+uint64_t DatabaseImage::sourceStamp(const string& indexFileName, const string& dataFileName) {
+    uint64_t stamp = 14695981039346656037ull;
+    for (const string* name : {&indexFileName, &dataFileName}) {
+        struct stat info;
+        if (stat(name->c_str(), &info) != 0)
+            return 0;
+        for (uint64_t value : {uint64_t(info.st_size), uint64_t(info.st_mtim.tv_sec), uint64_t(info.st_mtim.tv_nsec)})
+            stamp = (stamp ^ value) * 1099511628211ull;
+    }
+    return stamp == 0 ? 1 : stamp;
+}
+
+/**
+ * @brief Maps an image file read-only.
+ * @param path The image file.
+ * @return True if the file is a valid image.
+ */
+bool DatabaseImage::open(const string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    if (!attach(data, info.st_size)) {
+        munmap(data, info.st_size);
+        return false;
+    }
+    mapping = data;
+    mappingSize = info.st_size;
+    return true;
+}
+
+/**
+ * @brief Uses an image that is already in memory.
+ * @param data The first byte of the image.
+ * @param size The bytes available.
+ * @return True if the bytes are a valid image.
+ */
+bool DatabaseImage::attach(const void* data, size_t size) {
+    close();
+    const char* base = static_cast<const char*>(data);
+    const Header* h = static_cast<const Header*>(data);
+    if (size < sizeof(Header) || memcmp(h->magic, ImageMagic, sizeof(ImageMagic)) != 0
+        || h->version != Version || h->headerSize != sizeof(Header) || h->imageSize > size
+        || h->stateCount != StateCodes::NumStates)
+        return false;
+
+    // every section must lie inside the image
+    auto fits = [&](uint64_t offset, uint64_t bytes) {
+        return offset % 8 == 0 && offset <= h->imageSize && bytes <= h->imageSize - offset;
+    };
+    if (!fits(h->keysOffset, sizeof(int32_t) * uint64_t(h->recordCount))
+        || !fits(h->locationsOffset, sizeof(uint64_t) * uint64_t(h->recordCount))
+        || !fits(h->recordsOffset, sizeof(Record) * uint64_t(h->recordCount))
+        || !fits(h->fencesOffset, sizeof(Fence) * uint64_t(h->blockCount))
+        || !fits(h->stringIndexOffset, sizeof(uint32_t) * (uint64_t(h->stringCount) + 1))
+        || !fits(h->statesOffset, sizeof(StateSummary) * uint64_t(h->stateCount)))
+        return false;
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(base + h->stringIndexOffset);
+    if (!fits(h->stringBytesOffset, offsets[h->stringCount]))
+        return false;
+
+    header = h;
+    keys = reinterpret_cast<const int32_t*>(base + h->keysOffset);
+    locations = reinterpret_cast<const uint64_t*>(base + h->locationsOffset);
+    records = reinterpret_cast<const Record*>(base + h->recordsOffset);
+    fences = reinterpret_cast<const Fence*>(base + h->fencesOffset);
+    stringIndex = offsets;
+    stringBytes = base + h->stringBytesOffset;
+    states = reinterpret_cast<const StateSummary*>(base + h->statesOffset);
+    return true;
+}
+
+void DatabaseImage::close() {
+    if (mapping != nullptr)
+        munmap(mapping, mappingSize);
+    mapping = nullptr;
+    mappingSize = 0;
+    header = nullptr;
+}
+
+/**
+ * @brief Position of a zip code among the keys.
+ * @param zip The zip code.
+ * @return The position, or -1.
+ */
+int DatabaseImage::find(int zip) const {
+    int position = KeySearch::lowerBound(keys, header->recordCount, zip);
+    if (static_cast<uint32_t>(position) < header->recordCount && keys[position] == zip)
+        return position;
+    return -1;
+}
+
+/**
+ * @brief Record at a position.
+ * @param position A position from find.
+ * @param view Receives the record.
+ */
+void DatabaseImage::getRecord(int position, ZipCodeView& view) const {
+    const Record& r = records[position];
+    view.setNum(keys[position]);
+    view.setCity(getString(r.city));
+    view.setStateCode(getString(r.state));
+    view.setCounty(getString(r.county));
+    view.setLatMicro(r.latMicro);
+    view.setLonMicro(r.lonMicro);
+}
+
+/**
+ * @brief RBN of the block that holds or would hold a zip code.
+ * @param zip The zip code.
+ * @return The RBN of the first block whose highest zip is not below zip, or 0.
+ */
+int DatabaseImage::findBlock(int zip) const {
+    const Fence* end = fences + header->blockCount;
+    const Fence* it = lower_bound(fences, end, zip,
+                                  [](const Fence& fence, int key) { return fence.highestZip < key; });
+    return it == end ? 0 : it->rbn;
+}
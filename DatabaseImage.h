@@ -0,0 +1,178 @@
+/**
+ * @file DatabaseImage.h
+ * @brief Read-only snapshot of the database in one file that is queried where it is mapped.
+ * @details The image holds, each section aligned to 8 bytes and found through offsets
+ *          from the start of the file:
+ *          - the sorted zip keys, and for each key its data file offset and its record
+ *          - the block fences, each block's highest zip and RBN in zip order
+ *          - a dictionary of every city, county and state string
+ *          - the StateStats aggregates
+ *          - a stamp of the index and data file it was built from, so a reader can tell
+ *            when the files have changed since
+ *          Nothing in it is a pointer, so it can be mapped at any address and mapped
+ *          pages are shared by every process that opens the same image.
+ */
+
+#ifndef DATABASEIMAGE_H
+#define DATABASEIMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "BlockIndex.h"
+#include "PrimaryIndex.h"
+#include "StateStats.h"
+#include "ZipCodeView.h"
+using namespace std;
+
+class DatabaseImage {
+public:
+    /**
+     * @brief Format version written in the header.
+     */
+    static const uint32_t Version = 2;
+
+    // Start of the image
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t imageSize;
+        uint32_t recordCount;
+        uint32_t blockCount;
+        uint32_t stringCount;
+        uint32_t stateCount;
+        uint64_t keysOffset;          // int32_t[recordCount], ascending
+        uint64_t locationsOffset;     // uint64_t[recordCount], data file offsets
+        uint64_t recordsOffset;       // Record[recordCount]
+        uint64_t fencesOffset;        // Fence[blockCount], ascending by highestZip
+        uint64_t stringIndexOffset;   // uint32_t[stringCount + 1], offsets into the string bytes
+        uint64_t stringBytesOffset;
+        uint64_t statesOffset;        // StateSummary[stateCount], by StateCodes index
+        uint64_t sourceStamp;         // sourceStamp of the files it was built from, or 0
+    };
+
+    // Fields of a record other than its key; strings are dictionary ids
+    struct Record {
+        int32_t latMicro;
+        int32_t lonMicro;
+        uint32_t city;
+        uint32_t county;
+        uint32_t state;
+    };
+
+    // Highest zip of a block and where the block is
+    struct Fence {
+        int32_t highestZip;
+        int32_t rbn;
+    };
+
+    DatabaseImage();
+    ~DatabaseImage();
+
+    DatabaseImage(const DatabaseImage&) = delete;
+    DatabaseImage& operator=(const DatabaseImage&) = delete;
+
+    /**
+     * @brief Writes an image.
+     * @param path The image file to create.
+     * @param index Zip and data file offset of each record, in zip order.
+     * @param records The records, parallel to index.
+     * @param blocks The block index, or nullptr for an image without fences.
+     * @param stats The per-state aggregates.
+     * @param sourceStamp The stamp of the files the records were read from, or 0.
+     * @return False if the file could not be written.
+     */
+    static bool write(const string& path, const vector<IndexElement>& index, const vector<ZipCode>& records,
+                      const BlockIndex* blocks, const StateStats& stats, uint64_t sourceStamp = 0);
+
+    /**
+     * @brief Writes an image from the length-indicated data file and its primary index.
+     * @return False if the files could not be read or the image could not be written.
+     */
+    static bool build(const string& path, const string& indexFileName, const string& dataFileName,
+                      const BlockIndex* blocks);
+
+    /**
+     * @brief Fingerprint of the sizes and modification times of an index and data file.
+     * @post Changes whenever either file is rewritten or appended to. Returns 0 if
+     *       either file is missing.
+     */
+    static uint64_t sourceStamp(const string& indexFileName, const string& dataFileName);
+
+    /**
+     * @brief Maps an image file read-only.
+     * @return False if the file is missing or not a valid image.
+     */
+    bool open(const string& path);
+
+    /**
+     * @brief Uses an image that is already in memory, such as a shared memory segment.
+     * @pre data stays mapped until close or destruction.
+     * @return False if the bytes are not a valid image.
+     */
+    bool attach(const void* data, size_t size);
+
+    /**
+     * @brief Unmaps the image.
+     */
+    void close();
+
+    bool isOpen() const { return header != nullptr; }
+
+    int getRecordCount() const { return header->recordCount; }
+    int getBlockCount() const { return header->blockCount; }
+    uint64_t getSourceStamp() const { return header->sourceStamp; }
+    const int32_t* getKeys() const { return keys; }
+
+    /**
+     * @brief Position of a zip code among the keys.
+     * @return The position, or -1 if the zip code is not in the image.
+     */
+    int find(int zip) const;
+
+    /**
+     * @brief Data file offset of the record at a position.
+     */
+    uint64_t getOffset(int position) const { return locations[position]; }
+
+    /**
+     * @brief Record at a position.
+     * @param view Receives the record; its text points into the image.
+     */
+    void getRecord(int position, ZipCodeView& view) const;
+
+    /**
+     * @brief RBN of the block that holds or would hold a zip code, or 0 past the last block.
+     */
+    int findBlock(int zip) const;
+
+    /**
+     * @brief A string of the dictionary.
+     */
+    string_view getString(uint32_t id) const {
+        return string_view(stringBytes + stringIndex[id], stringIndex[id + 1] - stringIndex[id]);
+    }
+
+    /**
+     * @brief Aggregates of a state, by StateCodes index.
+     */
+    const StateSummary& getStateSummary(int state) const { return states[state]; }
+
+private:
+    const Header* header;
+    const int32_t* keys;
+    const uint64_t* locations;
+    const Record* records;
+    const Fence* fences;
+    const uint32_t* stringIndex;
+    const char* stringBytes;
+    const StateSummary* states;
+
+    void* mapping;          // set when the image was mapped by open
+    size_t mappingSize;
+};
+
+#endif // DATABASEIMAGE_H
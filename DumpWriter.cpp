@@ -0,0 +1,53 @@
+/**
+ * @file DumpWriter.cpp
+ * @brief Implementation of the DumpWriter class.
+ */
+
+#include "DumpWriter.h"
+#include <cerrno>
+#include <unistd.h>
+
+DumpWriter::DumpWriter(ostream& out) : stream(&out), fd(-1), ok(true) {
+    buffer.reserve(BufferSize);
+}
+
+DumpWriter::DumpWriter(int fd) : stream(nullptr), fd(fd), ok(true) {
+    buffer.reserve(BufferSize);
+}
+
+DumpWriter::~DumpWriter() {
+    flush();
+}
+
+/**
+ * @brief Hands the buffered bytes on.
+ * @post The buffer is empty.
+ */
+void DumpWriter::flush() {
+    emit(buffer.data(), buffer.size());
+    buffer.clear();
+    if (stream != nullptr)
+        stream->flush();
+}
+
+// Writes bytes to the stream or descriptor, retrying short writes
+void DumpWriter::emit(const char* data, size_t size) {
+    if (size == 0 || !ok)
+        return;
+    if (stream != nullptr) {
+        stream->write(data, size);
+        ok = stream->good();
+        return;
+    }
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            ok = false;
+            return;
+        }
+        data += written;
+        size -= written;
+    }
+}
@@ -0,0 +1,91 @@
+/**
+ * @file DumpWriter.h
+ * @brief Buffered text output for dumps and reports that may be far larger than memory.
+ */
+
+#ifndef DUMPWRITER_H
+#define DUMPWRITER_H
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include "NumberCodec.h"
+using namespace std;
+
+class DumpWriter {
+public:
+    /**
+     * @brief Bytes gathered before they are handed to the stream or descriptor.
+     */
+    static const int BufferSize = 64 * 1024;
+
+    /**
+     * @brief Writes to a stream.
+     * @pre out outlives the writer.
+     */
+    explicit DumpWriter(ostream& out);
+
+    /**
+     * @brief Writes to a file descriptor, which the writer does not close.
+     */
+    explicit DumpWriter(int fd);
+
+    DumpWriter(const DumpWriter&) = delete;
+    DumpWriter& operator=(const DumpWriter&) = delete;
+
+    /**
+     * @brief Flushes whatever is still buffered.
+     */
+    ~DumpWriter();
+
+    // Appends text; the buffer is handed on whenever it fills
+    void write(string_view text) {
+        if (buffer.size() + text.size() > BufferSize)
+            flush();
+        if (text.size() > BufferSize)
+            emit(text.data(), text.size());
+        else
+            buffer.append(text);
+    }
+
+    void put(char c) {
+        if (buffer.size() == BufferSize)
+            flush();
+        buffer.push_back(c);
+    }
+
+    // Formats the integer straight into the buffer
+    void writeInt(long value) {
+        if (buffer.size() + NumberCodec::MaxChars > BufferSize)
+            flush();
+        char temp[NumberCodec::MaxChars];
+        buffer.append(temp, NumberCodec::writeInt(temp, value));
+    }
+
+    DumpWriter& operator<<(string_view text) { write(text); return *this; }
+    DumpWriter& operator<<(const char* text) { write(text); return *this; }
+    DumpWriter& operator<<(char c) { put(c); return *this; }
+    DumpWriter& operator<<(int value) { writeInt(value); return *this; }
+    DumpWriter& operator<<(long value) { writeInt(value); return *this; }
+
+    /**
+     * @brief Hands the buffered bytes to the stream or descriptor.
+     * @post The buffer is empty; its storage is kept for the next bytes.
+     */
+    void flush();
+
+    /**
+     * @brief False once a write to the stream or descriptor has failed.
+     */
+    bool good() const { return ok; }
+
+private:
+    void emit(const char* data, size_t size);
+
+    ostream* stream;
+    int fd;
+    bool ok;
+    string buffer;
+};
+
+#endif // DUMPWRITER_H
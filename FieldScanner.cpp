@@ -0,0 +1,180 @@
+/**
+ * @file FieldScanner.cpp
+ * @brief Implementation of the FieldScanner class.
+ * @details Candidate characters are located 32 bytes at a time with AVX2, 16 bytes at a
+ *          time with SSE2, or one byte at a time when neither is available. The build
+ *          flags (-mavx2, -msse2) decide which path is compiled in.
+ */
+
+#include "FieldScanner.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Index of the lowest set bit of a non-zero mask.
+ */
+static inline int lowestBit(unsigned int mask) {
+    return __builtin_ctz(mask);
+}
+
+/**
+ * @brief Finds the next delimiter, quote or newline.
+ * @param data The characters to scan.
+ * @param from The position to start scanning at.
+ * @param size The number of characters in data.
+ * @param delim The field delimiter.
+ * @return The position of the first match, or size if there is none.
+ */
+int FieldScanner::findSpecial(const char* data, int from, int size, char delim) {
+    int i = from;
+#if defined(__AVX2__)
+    const __m256i d32 = _mm256_set1_epi8(delim);
+    const __m256i q32 = _mm256_set1_epi8('"');
+    const __m256i n32 = _mm256_set1_epi8('\n');
+    for (; i + 32 <= size; i += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, d32),
+                       _mm256_or_si256(_mm256_cmpeq_epi8(chunk, q32), _mm256_cmpeq_epi8(chunk, n32)));
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(hits));
+        if (mask != 0)
+            return i + lowestBit(mask);
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i d16 = _mm_set1_epi8(delim);
+    const __m128i q16 = _mm_set1_epi8('"');
+    const __m128i n16 = _mm_set1_epi8('\n');
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, d16),
+                       _mm_or_si128(_mm_cmpeq_epi8(chunk, q16), _mm_cmpeq_epi8(chunk, n16)));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(hits));
+        if (mask != 0)
+            return i + lowestBit(mask);
+    }
+#endif
+    for (; i < size; i++) {
+        char c = data[i];
+        if (c == delim || c == '"' || c == '\n')
+            return i;
+    }
+    return size;
+}
+
+/**
+ * @brief Finds the next occurrence of a single character.
+ * @param data The characters to scan.
+ * @param from The position to start scanning at.
+ * @param size The number of characters in data.
+ * @param target The character to look for.
+ * @return The position of the first match, or size if there is none.
+ */
+int FieldScanner::findChar(const char* data, int from, int size, char target) {
+    int i = from;
+#if defined(__AVX2__)
+    const __m256i t32 = _mm256_set1_epi8(target);
+    for (; i + 32 <= size; i += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, t32)));
+        if (mask != 0)
+            return i + lowestBit(mask);
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i t16 = _mm_set1_epi8(target);
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, t16)));
+        if (mask != 0)
+            return i + lowestBit(mask);
+    }
+#endif
+    for (; i < size; i++) {
+        if (data[i] == target)
+            return i;
+    }
+    return size;
+}
+
+/**
+ * @brief Splits one row into field spans.
+ * @param data The characters to split.
+ * @param size The number of characters in data.
+ * @param delim The field delimiter.
+ * @param spans Receives one span per field.
+ * @return The number of characters consumed, including the terminating newline.
+ */
+int FieldScanner::split(const char* data, int size, char delim, vector<FieldSpan>& spans) {
+    spans.clear();
+    int pos = 0;
+    int fieldStart = 0;
+    int quoteStart = -1, quoteEnd = -1;
+    bool escaped = false;
+
+    while (true) {
+        int hit = findSpecial(data, pos, size, delim);
+
+        if (hit < size && data[hit] == '"') {
+            // quoted section: skip to the closing quote, delimiters and newlines inside are data
+            int close = findChar(data, hit + 1, size, '"');
+            while (close + 1 < size && data[close + 1] == '"') {
+                // "" stands for one quote and does not close the section
+                escaped = true;
+                close = findChar(data, close + 2, size, '"');
+            }
+            if (quoteStart < 0) {
+                quoteStart = hit + 1;
+                quoteEnd = close;
+            }
+            pos = close < size ? close + 1 : size;
+            continue;
+        }
+
+        FieldSpan span;
+        bool quoted = quoteStart >= 0;
+        span.escaped = escaped;
+        if (quoted) {
+            span.start = quoteStart;
+            span.length = quoteEnd - quoteStart;
+        } else {
+            int end = hit;
+            if (end > fieldStart && data[end - 1] == '\r' && (end == size || data[end] == '\n'))
+                end--;
+            span.start = fieldStart;
+            span.length = end - fieldStart;
+        }
+        quoteStart = quoteEnd = -1;
+        escaped = false;
+
+        if (hit == size) {
+            // an empty buffer has no fields; after a trailing delimiter the last field is empty
+            if (quoted || size > 0)
+                spans.push_back(span);
+            return size;
+        }
+
+        spans.push_back(span);
+        if (data[hit] == '\n')
+            return hit + 1;
+
+        fieldStart = pos = hit + 1;
+    }
+}
+
+/**
+ * @brief Copies a field with its "" pairs collapsed.
+ * @param data The characters the span points into.
+ * @param span The field.
+ * @param out Receives the unescaped text.
+ */
+void FieldScanner::unescape(const char* data, const FieldSpan& span, string& out) {
+    out.clear();
+    int end = span.start + span.length;
+    for (int i = span.start; i < end; i++) {
+        out.push_back(data[i]);
+        if (span.escaped && data[i] == '"' && i + 1 < end && data[i + 1] == '"')
+            i++;
+    }
+}
@@ -0,0 +1,63 @@
+/**
+ * @file FieldScanner.h
+ * @brief Vectorized scanner that locates delimiters, quotes and newlines in record text.
+ */
+
+#ifndef FIELDSCANNER_H
+#define FIELDSCANNER_H
+
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * @brief Location of one field inside a record buffer.
+ */
+struct FieldSpan {
+    int start;     // offset of the first character of the field
+    int length;    // number of characters in the field
+    bool escaped;  // the quoted field holds "" pairs, each standing for one quote
+};
+
+class FieldScanner {
+public:
+    /**
+     * @brief Finds the next delimiter, quote or newline.
+     * @pre data holds at least size characters and from <= size.
+     * @post Returns the position of the first match at or after from, or size if there is none.
+     */
+    static int findSpecial(const char* data, int from, int size, char delim);
+
+    /**
+     * @brief Finds the next occurrence of a single character.
+     * @pre data holds at least size characters and from <= size.
+     * @post Returns the position of the first match at or after from, or size if there is none.
+     */
+    static int findChar(const char* data, int from, int size, char target);
+
+    /**
+     * @brief Splits one row into field spans.
+     * @pre data holds at least size characters.
+     * @post spans is replaced with the fields of the first row. Quoted fields may contain
+     *       delimiters, newlines and "" pairs; their enclosing quotes are not part of the
+     *       span, and a span with "" pairs is marked escaped. A row that ends with a
+     *       delimiter ends with an empty field. Returns the number of characters consumed,
+     *       including the row's newline.
+     */
+    static int split(const char* data, int size, char delim, vector<FieldSpan>& spans);
+
+    /**
+     * @brief Copies a field's text into out with each "" pair collapsed to one quote.
+     * @post out holds the field as it reads once unquoted; out is replaced, not appended to.
+     */
+    static void unescape(const char* data, const FieldSpan& span, string& out);
+
+    /**
+     * @brief Convenience overload of split for a whole string.
+     */
+    static int split(const string& text, char delim, vector<FieldSpan>& spans) {
+        return split(text.data(), static_cast<int>(text.size()), delim, spans);
+    }
+};
+
+#endif // FIELDSCANNER_H
@@ -0,0 +1,67 @@
+/**
+ * @file KeySearch.cpp
+ * @brief Implementation of the KeySearch class.
+ * @details A block holds a few dozen keys at most, so a vector compare over the whole
+ *          array beats a binary search for exact matches. AVX2 compares eight keys at a
+ *          time and SSE2 four; the scalar loop handles the rest.
+ */
+
+#include "KeySearch.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Finds a key by comparing several keys per instruction.
+ * @param keys The keys to search.
+ * @param count The number of keys.
+ * @param key The key to look for.
+ * @return The position of key, or -1.
+ */
+int KeySearch::find(const int* keys, int count, int key) {
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i target8 = _mm256_set1_epi32(key);
+    for (; i + 8 <= count; i += 8) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        unsigned int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(chunk, target8)));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i target4 = _mm_set1_epi32(key);
+    for (; i + 4 <= count; i += 4) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+        unsigned int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(chunk, target4)));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+    for (; i < count; i++) {
+        if (keys[i] == key)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Branchless binary search.
+ * @param keys The sorted keys.
+ * @param count The number of keys.
+ * @param key The key to position at.
+ * @return The position of the first key that is not below key.
+ */
+int KeySearch::lowerBound(const int* keys, int count, int key) {
+    if (count == 0)
+        return 0;
+    const int* base = keys;
+    int length = count;
+    while (length > 1) {
+        int half = length / 2;
+        base = (base[half] < key) ? base + half : base;   // compiles to a conditional move
+        length -= half;
+    }
+    return (base - keys) + (*base < key);
+}
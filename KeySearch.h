@@ -0,0 +1,26 @@
+/**
+ * @file KeySearch.h
+ * @brief Searches over a contiguous array of sorted integer keys.
+ */
+
+#ifndef KEYSEARCH_H
+#define KEYSEARCH_H
+
+class KeySearch {
+public:
+    /**
+     * @brief Finds a key by comparing several keys per instruction.
+     * @pre keys holds count integers.
+     * @post Returns the position of key, or -1 if it is not present.
+     */
+    static int find(const int* keys, int count, int key);
+
+    /**
+     * @brief Branchless binary search.
+     * @pre keys holds count integers in ascending order.
+     * @post Returns the position of the first key that is not below key, or count.
+     */
+    static int lowerBound(const int* keys, int count, int key);
+};
+
+#endif // KEYSEARCH_H
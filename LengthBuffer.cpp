@@ -3,7 +3,7 @@
  * Member function definitions for the LengthBuffer class.
  */
 #include "LengthBuffer.h"
-#include "ZipCode.h"
+#include "RecordCodec.h"
 #include <iostream>
 #include <string> 
 
@@ -41,8 +41,9 @@ LengthBuffer::LengthBuffer(char delim, int max) {
  * @post Returns true or false if the file wrote correctly.
  */
 void LengthBuffer::write(fstream& outFile) {
-    buffer.insert(0, to_string(buffer.size()));
-    outFile << buffer;
+    string prefix;
+    LengthFraming::appendPrefix(prefix, buffer.size());
+    outFile << prefix << buffer;
     buffer = "";
 }
 
@@ -53,30 +54,21 @@ void LengthBuffer::write(fstream& outFile) {
  * @param2 offset an integer variable containing the offset for the specific record.
  */
 bool LengthBuffer::read(fstream& inFile, unsigned long offset) {
-    char temp1, temp2;
-    int length;
+    char digits[LengthFraming::PrefixDigits];
+    int length = 0;
     index = 0;
     buffer = "";
     size = 0;
 
     inFile.seekg(offset);    // seek to start of record
 
-    temp1 = inFile.get();   // get first two characters to decode length
-    temp2 = inFile.get();
-    buffer.push_back(temp1);   // add characters to buffer
-    buffer.push_back(temp2);
+    inFile.read(digits, LengthFraming::PrefixDigits);    // get first two characters to decode length
+    NumberCodec::parseInt(digits, digits + LengthFraming::PrefixDigits, length);   // convert length ascii to int
 
-    length = stoi(buffer);     // convert length ascii to int
-
-    buffer = "";
-
-    int i = 0;
-    while (i < length) {
-        inFile.get(temp1);
-        buffer.push_back(temp1);
-        size++;
-        i++;
-    }
+    buffer.resize(length);
+    inFile.read(&buffer[0], length);   // pull the whole record in one call
+    size = inFile.gcount();
+    buffer.resize(size);
 
     return true;
 }
@@ -88,19 +80,31 @@ bool LengthBuffer::read(fstream& inFile, unsigned long offset) {
  * @post Returns true if the string was unpacked; otherwise, it returns false.
  */
 bool LengthBuffer::unpack(string& field) {
-    if (index != size && size != 0) {   // execute only when LengthBuffer is not empty
-
-        while (index < size && buffer[index] != delim) {
-            field.push_back(buffer[index++]);
-        }
-        if (buffer[index] == delim)
-            index++;
+    int start, length;
+    if (index < size && LengthCodec::nextField(buffer.data(), size, index, start, length, delim)) {
+        field.append(buffer, start, length);   // execute only when fields remain in the LengthBuffer
         return true;
-
     }
     return false;
 }
 
+/*
+ * @brief Unpacks the whole record into a ZipCode.
+ * @param1 zip a ZipCode which receives the fields.
+ * @post Returns true if every field was present.
+ */
+bool LengthBuffer::unpack(ZipCode& zip) {
+    return size != 0 && LengthCodec::decodeBody(buffer.data(), size, zip);
+}
+
+bool LengthBuffer::unpack(ZipCodeView& zip) {
+    return size != 0 && LengthViewCodec::decodeBody(buffer.data(), size, zip);
+}
+
 void LengthBuffer::pack(string& field) {
     buffer.append(field);
 }
+
+void LengthBuffer::pack(const ZipCode& zip) {
+    LengthCodec::appendBody(zip, buffer);
+}
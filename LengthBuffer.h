@@ -10,6 +10,8 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include "zipCode.h"
+#include "ZipCodeView.h"
 using namespace std;
 
 /**
@@ -45,6 +47,12 @@ public:
 
     void pack(string& field);
 
+    /**
+     * @brief Appends the fields of a ZipCode to the LengthBuffer.
+     * @post The buffer holds the record body, ready for write.
+     */
+    void pack(const ZipCode& zip);
+
     /**
      * @brief Separates each field from the line in the LengthBuffer.
      * @pre LengthBuffer must not be empty.
@@ -52,6 +60,19 @@ public:
      */
     bool unpack(string& field);
 
+    /**
+     * @brief Parses the whole record in the LengthBuffer into a ZipCode.
+     * @pre read has loaded a record.
+     * @post Returns true if every field was present.
+     */
+    bool unpack(ZipCode& zip);
+
+    /**
+     * @brief Parses the record into a view over the LengthBuffer.
+     * @post The view's text fields stay valid until the next read.
+     */
+    bool unpack(ZipCodeView& zip);
+
     int getSize() { 
         return buffer.size(); }
 
@@ -59,7 +80,7 @@ public:
      * @brief Gives the LengthBuffer string.
      * @post Returns the LengthBuffer string.
      */
-    string getBuffer() { 
+    const string& getBuffer() const { 
         return buffer; }
 
 };
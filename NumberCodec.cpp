@@ -0,0 +1,194 @@
+/**
+ * @file NumberCodec.cpp
+ * @brief Implementation of the NumberCodec class on top of std::from_chars and std::to_chars.
+ */
+
+#include "NumberCodec.h"
+#include <charconv>
+#include <climits>
+#include <cmath>
+
+FloatFormat NumberCodec::floatFormat = FIXED_FLOAT;
+
+/**
+ * @brief Parses a whole integer field.
+ * @param first The first character of the field.
+ * @param last One past the last character of the field.
+ * @param value Receives the number.
+ * @return True if the whole field was an integer.
+ */
+bool NumberCodec::parseInt(const char* first, const char* last, int& value) {
+    if (first != last && *first == '+')
+        first++;
+    from_chars_result result = from_chars(first, last, value);
+    return result.ec == errc() && result.ptr == last;
+}
+
+/**
+ * @brief Parses a whole floating point field.
+ * @param first The first character of the field.
+ * @param last One past the last character of the field.
+ * @param value Receives the number.
+ * @return True if the whole field was a number.
+ */
+bool NumberCodec::parseFloat(const char* first, const char* last, float& value) {
+    if (first != last && *first == '+')
+        first++;
+    from_chars_result result = from_chars(first, last, value);
+    return result.ec == errc() && result.ptr == last;
+}
+
+/**
+ * @brief Parses a whole decimal field into millionths.
+ * @param first The first character of the field.
+ * @param last One past the last character of the field.
+ * @param value Receives the number times Fixed6Scale.
+ * @return True if the whole field was a number that fits.
+ * @details Digits are accumulated as integers, so "45.5608" gives exactly 45560800. Text
+ *          with an exponent is rare and falls back to a double conversion.
+ */
+bool NumberCodec::parseFixed6(const char* first, const char* last, int& value) {
+    const char* p = first;
+    bool negative = false;
+    if (p != last && (*p == '+' || *p == '-')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    long long whole = 0;
+    int digits = 0;
+    for (; p != last && *p >= '0' && *p <= '9'; p++, digits++) {
+        whole = whole * 10 + (*p - '0');
+        if (whole > INT_MAX / Fixed6Scale)
+            return false;
+    }
+
+    long long fraction = 0;
+    int places = 0;
+    bool roundUp = false;
+    if (p != last && *p == '.') {
+        for (p++; p != last && *p >= '0' && *p <= '9'; p++, digits++) {
+            if (places < 6)
+                fraction = fraction * 10 + (*p - '0');
+            else if (places == 6)
+                roundUp = *p >= '5';
+            places++;
+        }
+    }
+
+    if (p != last || digits == 0) {
+        double number;
+        if (first != last && *first == '+')
+            first++;
+        from_chars_result result = from_chars(first, last, number);
+        if (result.ec != errc() || result.ptr != last || fabs(number) * Fixed6Scale > INT_MAX)
+            return false;
+        value = static_cast<int>(llround(number * Fixed6Scale));
+        return true;
+    }
+
+    for (; places < 6; places++)
+        fraction *= 10;
+    long long magnitude = whole * Fixed6Scale + fraction + (roundUp ? 1 : 0);
+    if (magnitude > INT_MAX)
+        return false;
+    value = static_cast<int>(negative ? -magnitude : magnitude);
+    return true;
+}
+
+/**
+ * @brief Writes an integer as ASCII.
+ * @param out Destination with room for MaxChars characters.
+ * @param value The number to write.
+ * @return The position after the last character written.
+ */
+char* NumberCodec::writeInt(char* out, long value) {
+    return to_chars(out, out + MaxChars, value).ptr;
+}
+
+/**
+ * @brief Writes a float as ASCII in the current FloatFormat.
+ * @param out Destination with room for MaxChars characters.
+ * @param value The number to write.
+ * @return The position after the last character written.
+ */
+char* NumberCodec::writeFloat(char* out, float value) {
+    if (floatFormat == SHORTEST_FLOAT)
+        return to_chars(out, out + MaxChars, value).ptr;
+    return to_chars(out, out + MaxChars, value, chars_format::fixed, 6).ptr;
+}
+
+/**
+ * @brief Writes a count of millionths as a decimal in the current FloatFormat.
+ * @param out Destination with room for MaxChars characters.
+ * @param value The number times Fixed6Scale.
+ * @return The position after the last character written.
+ */
+char* NumberCodec::writeFixed6(char* out, int value) {
+    unsigned int magnitude = value < 0 ? 0U - static_cast<unsigned int>(value) : value;
+    if (value < 0)
+        *out++ = '-';
+    out = to_chars(out, out + MaxChars, magnitude / Fixed6Scale).ptr;
+
+    unsigned int fraction = magnitude % Fixed6Scale;
+    int places = 6;
+    if (floatFormat == SHORTEST_FLOAT) {
+        if (fraction == 0)
+            return out;
+        for (; fraction % 10 == 0; fraction /= 10)
+            places--;
+    }
+
+    *out++ = '.';
+    for (int i = places - 1; i >= 0; i--) {
+        out[i] = '0' + fraction % 10;
+        fraction /= 10;
+    }
+    return out + places;
+}
+
+void NumberCodec::appendInt(string& out, long value) {
+    char temp[MaxChars];
+    out.append(temp, writeInt(temp, value));
+}
+
+void NumberCodec::appendFloat(string& out, float value) {
+    char temp[MaxChars];
+    out.append(temp, writeFloat(temp, value));
+}
+
+void NumberCodec::appendFixed6(string& out, int value) {
+    char temp[MaxChars];
+    out.append(temp, writeFixed6(temp, value));
+}
+
+/**
+ * @brief Counts the characters of an integer without writing it.
+ * @param value The number to measure.
+ * @return The number of characters including any sign.
+ */
+int NumberCodec::intLength(long value) {
+    int length = 1;
+    unsigned long magnitude = value < 0 ? 0UL - static_cast<unsigned long>(value) : value;
+    if (value < 0)
+        length++;
+    while (magnitude >= 10) {
+        magnitude /= 10;
+        length++;
+    }
+    return length;
+}
+
+int NumberCodec::floatLength(float value) {
+    char temp[MaxChars];
+    return writeFloat(temp, value) - temp;
+}
+
+int NumberCodec::fixed6Length(int value) {
+    if (floatFormat == FIXED_FLOAT) {
+        unsigned int magnitude = value < 0 ? 0U - static_cast<unsigned int>(value) : value;
+        return (value < 0) + intLength(magnitude / Fixed6Scale) + 7;
+    }
+    char temp[MaxChars];
+    return writeFixed6(temp, value) - temp;
+}
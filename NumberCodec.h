@@ -0,0 +1,145 @@
+/**
+ * @file NumberCodec.h
+ * @brief Locale-free conversion between numbers and their ASCII text in records and headers.
+ */
+
+#ifndef NUMBERCODEC_H
+#define NUMBERCODEC_H
+
+#include <string>
+using namespace std;
+
+/**
+ * @brief How floating point fields are written.
+ */
+enum FloatFormat {
+    FIXED_FLOAT,    // six digits after the point, the same text as to_string(float)
+    SHORTEST_FLOAT  // fewest digits that read back to the same value
+};
+
+class NumberCodec {
+public:
+    /**
+     * @brief Room a caller must provide for writeInt and writeFloat.
+     */
+    static const int MaxChars = 64;
+
+    /**
+     * @brief Units per degree of a fixed-point coordinate, which counts micro-degrees.
+     */
+    static const int Fixed6Scale = 1000000;
+
+    /**
+     * @brief Parses a whole integer field.
+     * @pre [first, last) holds the field text.
+     * @post value holds the number. Returns false if the text is not entirely an integer.
+     */
+    static bool parseInt(const char* first, const char* last, int& value);
+
+    /**
+     * @brief Parses a whole floating point field.
+     * @pre [first, last) holds the field text.
+     * @post value holds the number. Returns false if the text is not entirely a number.
+     */
+    static bool parseFloat(const char* first, const char* last, float& value);
+
+    /**
+     * @brief Parses a whole decimal field into millionths without going through a float.
+     * @pre [first, last) holds the field text.
+     * @post value holds the number times Fixed6Scale, rounded half away from zero at the
+     *       seventh decimal. Returns false if the text is not a number or does not fit.
+     */
+    static bool parseFixed6(const char* first, const char* last, int& value);
+
+    /**
+     * @brief Parses an integer field, giving 0 for text that is not a number.
+     */
+    static int toInt(const char* text, int length) {
+        int value = 0;
+        parseInt(text, text + length, value);
+        return value;
+    }
+
+    /**
+     * @brief Parses a floating point field, giving 0 for text that is not a number.
+     */
+    static float toFloat(const char* text, int length) {
+        float value = 0;
+        parseFloat(text, text + length, value);
+        return value;
+    }
+
+    /**
+     * @brief Parses a decimal field into millionths, giving 0 for text that is not a number.
+     */
+    static int toFixed6(const char* text, int length) {
+        int value = 0;
+        parseFixed6(text, text + length, value);
+        return value;
+    }
+
+    /**
+     * @brief Writes an integer as ASCII.
+     * @pre out has room for MaxChars characters.
+     * @post Returns the position after the last character written.
+     */
+    static char* writeInt(char* out, long value);
+
+    /**
+     * @brief Writes a float as ASCII in the current FloatFormat.
+     * @pre out has room for MaxChars characters.
+     * @post Returns the position after the last character written.
+     */
+    static char* writeFloat(char* out, float value);
+
+    /**
+     * @brief Writes a count of millionths as a decimal in the current FloatFormat.
+     * @pre out has room for MaxChars characters.
+     * @post Returns the position after the last character written. The text parses
+     *       back to exactly value with parseFixed6.
+     */
+    static char* writeFixed6(char* out, int value);
+
+    /**
+     * @brief Appends an integer to a string.
+     */
+    static void appendInt(string& out, long value);
+
+    /**
+     * @brief Appends a float to a string in the current FloatFormat.
+     */
+    static void appendFloat(string& out, float value);
+
+    /**
+     * @brief Appends a count of millionths to a string as a decimal.
+     */
+    static void appendFixed6(string& out, int value);
+
+    /**
+     * @brief Number of characters appendInt would write.
+     */
+    static int intLength(long value);
+
+    /**
+     * @brief Number of characters appendFloat would write.
+     */
+    static int floatLength(float value);
+
+    /**
+     * @brief Number of characters appendFixed6 would write.
+     */
+    static int fixed6Length(int value);
+
+    /**
+     * @brief Chooses how floats are written. FIXED_FLOAT is the default and matches
+     *        files written before this class existed.
+     */
+    static void setFloatFormat(FloatFormat format) { floatFormat = format; }
+
+    static FloatFormat getFloatFormat() { return floatFormat; }
+
+private:
+    static FloatFormat floatFormat;
+};
+
+#endif // NUMBERCODEC_H
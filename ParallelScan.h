@@ -0,0 +1,175 @@
+/**
+ * @file ParallelScan.h
+ * @brief Reads and decodes a range of blocks on several threads and hands the results
+ *        back in RBN order.
+ * @details The RBN range is cut into chunks of consecutive blocks. Chunks are dealt out
+ *          round-robin to per-worker queues; a worker takes from the front of its own
+ *          queue and, once that is empty, steals from the back of another's. Each worker
+ *          has its own stream and BlockBuffer, so blocks are read and decoded without
+ *          any shared state. The calling thread emits chunk results strictly in order.
+ *          Workers may run at most a fixed window of chunks ahead of the output, which
+ *          bounds the memory held in results no matter how large the file is.
+ */
+
+#ifndef PARALLELSCAN_H
+#define PARALLELSCAN_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BlockBuffer.h"
+using namespace std;
+
+class ParallelScan {
+public:
+    /**
+     * @brief Blocks per chunk unless the caller chooses otherwise.
+     */
+    static const int DefaultChunkBlocks = 32;
+
+    /**
+     * @brief Chunks each worker may finish ahead of the one being emitted.
+     */
+    static const int ChunksAheadPerWorker = 4;
+
+    /**
+     * @brief Prepares a scan of blocks firstRBN through lastRBN of a file.
+     * @param fileName The blocked sequence set file; each worker opens it for reading.
+     * @param threads Worker count, or 0 for one per hardware thread.
+     * @param chunkBlocks Consecutive blocks handed to a worker at a time.
+     */
+    ParallelScan(const string& fileName, int firstRBN, int lastRBN, int threads = 0,
+                 int chunkBlocks = DefaultChunkBlocks)
+        : fileName(fileName), firstRBN(firstRBN), lastRBN(lastRBN),
+          threads(threads > 0 ? threads : max(1u, thread::hardware_concurrency())),
+          chunkBlocks(max(1, chunkBlocks)) {}
+
+    /**
+     * @brief Runs the scan.
+     * @param visit Called as visit(rbn, buffer, result) on a worker thread for every block
+     *              of a chunk, in RBN order, after the block has been read into buffer.
+     *              result collects the chunk's output.
+     * @param emit Called as emit(result) on the calling thread once per chunk, in RBN order.
+     * @pre visit only touches its arguments and state it synchronizes itself.
+     * @post Returns false if a worker could not open the file; the chunks it would have
+     *       read are emitted with empty results.
+     */
+    template <class Result, class Visit, class Emit>
+    bool run(Visit visit, Emit emit) {
+        int chunks = (lastRBN - firstRBN + chunkBlocks) / chunkBlocks;
+        if (chunks <= 0)
+            return true;
+        int workers = min(threads, chunks);
+        int window = workers * ChunksAheadPerWorker;
+
+        vector<WorkQueue> queues(workers);
+        for (int c = 0; c < chunks; c++)
+            queues[c % workers].chunks.push_back(c);
+
+        vector<Result> slots(window);
+        vector<char> ready(window, 0);
+        mutex stateLock;
+        condition_variable changed;
+        int emitted = 0;
+        bool opened = true;
+
+        auto work = [&](int self) {
+            ifstream in(fileName, ios::binary);
+            BlockBuffer buffer;
+            bool readable = in.is_open();
+            if (!readable) {
+                lock_guard<mutex> guard(stateLock);
+                opened = false;
+            }
+
+            int chunk;
+            while (take(queues, self, chunk)) {
+                {
+                    unique_lock<mutex> waiting(stateLock);
+                    changed.wait(waiting, [&] { return chunk < emitted + window; });
+                }
+
+                // the slot's previous chunk has been emitted, so it is ours alone
+                Result& out = slots[chunk % window];
+                out = Result();
+                int begin = firstRBN + chunk * chunkBlocks;
+                int end = min(lastRBN, begin + chunkBlocks - 1);
+                for (int rbn = begin; readable && rbn <= end; rbn++) {
+                    buffer.read(in, rbn);
+                    visit(rbn, buffer, out);
+                }
+
+                {
+                    lock_guard<mutex> guard(stateLock);
+                    ready[chunk % window] = 1;
+                }
+                changed.notify_all();
+            }
+        };
+
+        vector<thread> pool;
+        for (int i = 0; i < workers; i++)
+            pool.emplace_back(work, i);
+
+        for (int c = 0; c < chunks; c++) {
+            {
+                unique_lock<mutex> waiting(stateLock);
+                changed.wait(waiting, [&] { return ready[c % window] != 0; });
+            }
+            emit(slots[c % window]);
+            {
+                lock_guard<mutex> guard(stateLock);
+                ready[c % window] = 0;
+                emitted = c + 1;
+            }
+            changed.notify_all();
+        }
+
+        for (thread& worker : pool)
+            worker.join();
+        return opened;
+    }
+
+    int getThreadCount() const { return threads; }
+
+private:
+    // Chunks dealt to one worker, lowest first
+    struct WorkQueue {
+        mutex lock;
+        deque<int> chunks;
+    };
+
+    // Takes the worker's next chunk, or steals the last chunk of another worker
+    static bool take(vector<WorkQueue>& queues, int self, int& chunk) {
+        {
+            lock_guard<mutex> guard(queues[self].lock);
+            if (!queues[self].chunks.empty()) {
+                chunk = queues[self].chunks.front();
+                queues[self].chunks.pop_front();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); i++) {
+            WorkQueue& victim = queues[(self + i) % queues.size()];
+            lock_guard<mutex> guard(victim.lock);
+            if (!victim.chunks.empty()) {
+                chunk = victim.chunks.back();
+                victim.chunks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    string fileName;
+    int firstRBN, lastRBN;
+    int threads;
+    int chunkBlocks;
+};
+
+#endif // PARALLELSCAN_H
@@ -4,46 +4,157 @@
  */
 
 #include "PrimaryIndex.h"
+#include "NumberCodec.h"
+#include "RecordCodec.h"
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
 
 using namespace std;
 
-static const short NumStates = 57; // Number of possible states/regions
+static const short NumStates = StateCodes::NumStates; // Number of possible states/regions
 
 void PrimaryIndex::getIndex(vector<IndexElement>& returnValue) {
     IndexElement temp;
 
     int i = 0;
 while (i < index.size()) {
-    temp.zip = index[i].zip;
-    temp.offset = index[i].offset;
-    returnValue.push_back(temp);
+    // deleted zip codes are left out
+    if (!index[i].deleted) {
+        temp.zip = index[i].zip;
+        temp.offset = index[i].offset;
+        temp.deleted = false;
+        returnValue.push_back(temp);
+    }
     i++;
 }
 
 }
 
 void PrimaryIndex::add(int zipCode, unsigned long offset) {
-    IndexElement temp = {zipCode, offset};
-    int i = 0;
+    IndexElement temp = {zipCode, offset, false};
 
-    if (recordCount == 0) {
-        index.push_back(temp);
-    } else {
-        while (i < recordCount && index[i].zip < zipCode) {
-            i++;
-        }
-        if (i == recordCount) {
-            index.push_back(temp);
-        } else if (i == 0) {
-            index.insert(index.begin(), temp);
+    // binary search for the insert position; a sorted index file appends every time
+    vector<IndexElement>::iterator it = lower_bound(index.begin(), index.end(), zipCode,
+        [](const IndexElement& element, int zip) { return element.zip < zip; });
+    index.insert(it, temp);
+
+    recordCount++;
+}
+
+bool PrimaryIndex::remove(int zipCode) {
+    vector<IndexElement>::iterator it = lower_bound(index.begin(), index.end(), zipCode,
+        [](const IndexElement& element, int zip) { return element.zip < zip; });
+    if (it == index.end() || it->zip != zipCode || it->deleted)
+        return false;
+
+    it->deleted = true;
+    deletedCount++;
+    return true;
+}
+
+bool PrimaryIndex::fits(const ZipCode& record) {
+    return LengthCodec::bodyLength(record) <= LengthFraming::MaxBody;
+}
+
+bool PrimaryIndex::append(const vector<ZipCode>& records) {
+    // a longer body would get a three-digit length that no reader expects
+    for (const ZipCode& record : records) {
+        if (!fits(record))
+            return false;
+    }
+
+    fstream out(dataFileName, ios::in | ios::out | ios::binary | ios::ate);
+    if (!out.is_open())
+        return false;
+
+    LengthBuffer buf;
+    unsigned long offset = out.tellp();
+    for (const ZipCode& record : records) {
+        buf.pack(record);
+        unsigned long length = buf.getSize() + LengthFraming::PrefixDigits;
+        buf.write(out);
+
+        vector<IndexElement>::iterator it = lower_bound(index.begin(), index.end(), record.getNum(),
+            [](const IndexElement& element, int zip) { return element.zip < zip; });
+        if (it != index.end() && it->zip == record.getNum()) {
+            // the old copy is dead until compact drops it
+            if (it->deleted)
+                deletedCount--;
+            it->deleted = false;
+            it->offset = offset;
+            staleCount++;
         } else {
-            vector<IndexElement>::iterator it;
-            it = index.begin();
-            index.insert(it + i, temp);
+            add(record.getNum(), offset);
         }
+        offset += length;
     }
+    out.close();
+    return !out.fail();
+}
 
-    recordCount++;
+bool PrimaryIndex::compact(double maxDeletedShare) {
+    int dead = deletedCount + staleCount;
+    if (dead == 0 || dead <= maxDeletedShare * (recordCount + staleCount))
+        return false;
+
+    ifstream in(dataFileName, ios::binary);
+    if (!in.is_open())
+        return false;
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+
+    // the header ends with its First Key line; a replaced record may come before the
+    // first record still indexed
+    unsigned long headerSize = data.size();
+    for (const IndexElement& element : index)
+        headerSize = min(headerSize, element.offset);
+    size_t keyLine = data.find("\nFirst Key:");
+    if (keyLine != string::npos && data.find('\n', keyLine + 1) != string::npos)
+        headerSize = min<unsigned long>(headerSize, data.find('\n', keyLine + 1) + 1);
+
+    vector<IndexElement*> live;
+    for (IndexElement& element : index) {
+        if (!element.deleted)
+            live.push_back(&element);
+    }
+    sort(live.begin(), live.end(),
+        [](const IndexElement* a, const IndexElement* b) { return a->offset < b->offset; });
+
+    string packed = data.substr(0, headerSize);
+    // the header's record count describes the rewritten file
+    const string countField = "Record Count: ";
+    size_t countAt = packed.find(countField);
+    if (countAt != string::npos) {
+        countAt += countField.size();
+        packed.replace(countAt, packed.find('\n', countAt) - countAt, to_string(live.size()));
+    }
+    for (IndexElement* element : live) {
+        int bodyStart, bodyLength;
+        int length = element->offset < data.size()
+            ? LengthFraming::locate(data.data() + element->offset, data.size() - element->offset, bodyStart, bodyLength)
+            : 0;
+        if (length == 0)
+            return false;       // the index does not match the data file; leave both alone
+        unsigned long moved = packed.size();
+        packed.append(data, element->offset, length);
+        element->offset = moved;
+    }
+
+    string tempName = dataFileName + ".tmp";
+    ofstream out(tempName, ios::binary | ios::trunc);
+    out.write(packed.data(), packed.size());
+    out.close();
+    if (!out || rename(tempName.c_str(), dataFileName.c_str()) != 0)
+        return false;
+
+    index.erase(remove_if(index.begin(), index.end(),
+        [](const IndexElement& element) { return element.deleted; }), index.end());
+    recordCount = index.size();
+    deletedCount = 0;
+    staleCount = 0;
+    writeToFile();
+    return true;
 }
 
 unsigned long PrimaryIndex::search(int targetZipCode) {
@@ -60,14 +171,17 @@ unsigned long PrimaryIndex::binarySearch(int target, int left, int right) {
         int mid = (left + right) / 2;
 
         if (index[mid].zip == target) {
+            if (index[mid].deleted)
+                return 0;
             cout << "Target hit!: " << index[mid].zip << ' ' << index[mid].offset << endl;
             return index[mid].offset;
         } else if (index[mid].zip > target) {
-            binarySearch(target, left, mid - 1);
+            return binarySearch(target, left, mid - 1);
         } else {
-            binarySearch(target, mid + 1, right);
+            return binarySearch(target, mid + 1, right);
         }
     }
+    return 0;
 }
 
 void PrimaryIndex::readIndex() {
@@ -80,36 +194,55 @@ void PrimaryIndex::readIndex() {
         unsigned long int offset;
         char temp;
 
-        while (!indexFile.eof()) {
-            indexFile >> zip >> temp >> offset;
+        while (indexFile >> zip >> temp >> offset) {
             add(zip, offset);
+            // a deleted zip code has a third field, D
+            if (indexFile.peek() == ',') {
+                indexFile >> temp >> temp;
+                if (temp == 'D')
+                    remove(zip);
+            }
         }
     }
 }
 
 void PrimaryIndex::writeToFile() {
     ofstream outFile;
-    outFile.open("IndexFile.index");
+    outFile.open(indexFileName);
 
     outFile << recordCount << "\n";
 
     for (int i = 0; i < recordCount; i++) {
-        outFile << index[i].zip << "," << index[i].offset << "\n";
+        outFile << index[i].zip << "," << index[i].offset;
+        if (index[i].deleted)
+            outFile << ",D";
+        outFile << "\n";
     }
 }
 
-void PrimaryIndex::readCSV(ifstream& infile) {
-    indexFile.open("IndexFile.index");
-    dataFile.open("DataFile.licsv");
+bool PrimaryIndex::readCSV(ifstream& infile) {
+    // every record of the import lives in one arena that is released in a single step
+    Arena ingestArena(1 << 20);
+    vector<StateBucket> states(NumStates, StateBucket(ArenaAllocator<ZipCode>(&ingestArena)));
+    string headerData;
+    if (!readIn(infile, states, headerData))
+        return false;
 
-    vector<vector<ZipCode>> states;
-    states.resize(NumStates);
-    string headerData = readIn(infile, states);
-    cout << endl << printTable(states) << endl;
+    // an import regenerates the data file, so a longer earlier one must not show through
+    indexFile.open(indexFileName);
+    dataFile.open(dataFileName, ios::out | ios::trunc);
+
+    StateStats stats;
+    for (const StateBucket& bucket : states) {
+        for (const ZipCode& zip : bucket)
+            stats.add(zip);
+    }
+    cout << endl << stats.printTable() << endl;
 
     transfer(states, headerData);
 
     writeToFile();
+    return true;
 }
 
 string PrimaryIndex::buildHeader(string headerData) {
@@ -160,195 +293,74 @@ string PrimaryIndex::buildHeader(string headerData) {
     return record;
 }
 
-void PrimaryIndex::transfer(vector<vector<ZipCode>>& states, string headerData) {
+void PrimaryIndex::transfer(vector<StateBucket>& states, string headerData) {
     if (!dataFile.is_open()) {
-        dataFile.open("DataFile.licsv");
+        dataFile.open(dataFileName, ios::out | ios::trunc);
     }
 
     string header = buildHeader(headerData);
     dataFile << header;
 
-    string temp;
     LengthBuffer buf;
     unsigned long count = 0;
-    unsigned long offsetSum = header.size() + 11;
+    unsigned long offsetSum = header.size();     // the first record follows the header
 
-    for (int i = 0; i < NumStates; i++) {
+    int tooLong = 0;
+    for (size_t i = 0; i < states.size(); i++) {
         for (int j = 0; j < states[i].size(); j++) {
-            count = 0;
-
-            temp = to_string(states[i][j].getNum());
-            temp.push_back(',');
-            temp.append(states[i][j].getCity());
-            temp.push_back(',');
-            temp.append(states[i][j].getStateCode());
-            temp.push_back(',');
-            temp.append(states[i][j].getCounty());
-            temp.push_back(',');
-            temp.append(to_string(states[i][j].getLat()));
-            temp.push_back(',');
-            temp.append(to_string(states[i][j].getLon()));
-
-            count = temp.size();
-            
-            buf.pack(temp);
+            if (!fits(states[i][j])) {
+                tooLong++;
+                continue;
+            }
+            buf.pack(states[i][j]);
+            count = buf.getSize();
             buf.write(dataFile);
 
             add(states[i][j].getNum(), offsetSum);
             offsetSum += count + 2;
         }
     }
+    if (tooLong > 0)
+        cout << tooLong << " records too long for the data file were not imported" << endl;
 }
 
-string PrimaryIndex::readIn(ifstream& inFile, vector<vector<ZipCode>>& states) {
+bool PrimaryIndex::readIn(ifstream& inFile, vector<StateBucket>& states, string& headerData) {
     ZipCode temp;
-    string item;
-    string headerData;
-    vector<string> headerElement;
     delimBuffer b;
+    RowParser parser;
 
-    for (int i = 0; i < 3; ++i) {
-        b.read(inFile);
-        headerData.append(b.getBuffer());
-    }
-
-    for (int i = 0; i < headerData.size(); i++) {
-        headerData[i] = tolower(headerData[i]);
-    }
-    for (int i = 0, j = 0, k = 0; i < headerData.size(); ++i, k = 0) {
-        string temps = "";
-        while (headerData[i] != ',' && i < headerData.size()) {
-            if (isalpha(headerData[i])) {
-                temps.push_back(headerData[i]);
-            }
-            i++;
-        }
+    b.readHeader(inFile, headerData);
 
-        headerElement.resize(headerElement.size() + 1);
-        headerElement[j++] = temps;
+    if (!parser.resolveHeader(headerData)) {
+        cout << "Header is missing one or more zip code fields: " << headerData << endl;
+        return false;
     }
 
-    int tag = 0;
-
+    // a state code outside the fixed table gets an id past it and a bucket of its own,
+    // so the import keeps the same rows as -reimport
+    int unlisted = 0;
     while (b.read(inFile)) {
-        while (b.unpack(item)) {
-            if (tag > 5) tag = 0;
-
-            if (headerElement[tag] == "zipcode") {
-                temp.setNum(stoi(item));
-            } else if (headerElement[tag] == "placename") {
-                temp.setCity(item);
-            } else if (headerElement[tag] == "state") {
-                temp.setStateCode(item);
-            } else if (headerElement[tag] == "county") {
-                temp.setCounty(item);
-            } else if (headerElement[tag] == "lat") {
-                temp.setLat(stof(item));
-            } else if (headerElement[tag] == "long") {
-                temp.setLon(stof(item));
-            }
-            ++tag;
-            item = "";
-        }
-        states[stateSelector(temp.getStateCode())].push_back(ZipCode(temp));
+        if (b.getBuffer().empty() || !parser.parse(b.getBuffer(), temp))
+            continue;
+        size_t state = temp.getStateIndex();     // already resolved when the row was parsed
+        if (state >= static_cast<size_t>(NumStates))
+            unlisted++;
+        if (state >= states.size())
+            states.resize(state + 1, StateBucket(states[0].get_allocator()));
+        states[state].push_back(temp);
     }
+    if (unlisted > 0)
+        cout << unlisted << " rows with a state code outside the table were kept" << endl;
 
-    return headerData;
-}
-
-string PrimaryIndex::printTable(vector<vector<ZipCode>>& states) {
-    string output;
-
-    output.append("*****************************************************\n");
-    output.append("*State\t|East\t\t|West\t\t|North\t\t|South\t*\n");
-    output.append("*****************************************************\n");
-
-    for (int i = 0; i < NumStates; i++) {
-        output.append("*");
-        output.append(states[i][0].getStateCode());
-        output.append("\t|");
-        output.append(to_string(states[i][eastest(states[i])].getNum()));
-        output.append("\t\t|");
-        output.append(to_string(states[i][westest(states[i])].getNum()));
-        output.append("\t\t|");
-        output.append(to_string(states[i][northest(states[i])].getNum()));
-        output.append("\t\t|");
-        output.append(to_string(states[i][southest(states[i])].getNum()));
-        output.append("\t*\n");
-    }
-    output.append("*****************************************************\n");
-    output.append("*State\t|East\t\t|West\t\t|North\t\t|South\t*\n");
-    output.append("*****************************************************");
-
-    return output;
-}
-
-short PrimaryIndex::northest(vector<ZipCode> state) {
-    short x = 0;
-    for (int i = 1; i < state.size(); i++) {
-        if (state[i].getLat() > state[i - 1].getLat()) {
-            x = i;
-        }
-    }
-    return x;
-}
-
-short PrimaryIndex::southest(vector<ZipCode> state) {
-    short x = 0;
-    for (int i = 1; i < state.size(); i++) {
-        if (state[i].getLat() < state[i - 1].getLat()) {
-            x = i;
-        }
-    }
-    return x;
-}
-
-short PrimaryIndex::eastest(vector<ZipCode> state) {
-    short x = 0;
-    for (int i = 1; i < state.size(); i++) {
-        if (state[i].getLon() < state[i - 1].getLon()) {
-            x = i;
-        }
-    }
-    return x;
-}
-
-short PrimaryIndex::westest(vector<ZipCode> state) {
-    short x = 0;
-    for (int i = 1; i < state.size(); i++) {
-        if (state[i].getLon() > state[i - 1].getLon())
-			x = i;
-	}
-	return x;
+    return true;
 }
 
 /**
 * @brief Chooses which state array index is correct
-* with the use of a switch statement
-* @pre two character state code in a string is used as parameter
-* @post Returns the correct array index as an int
+* by looking the code up in the StateCodes table
+* @pre two character state code is used as parameter
+* @post Returns the correct array index as an int, or -1
 */
-short PrimaryIndex::stateSelector(const std::string& stateCode) {
-    static const std::unordered_map<std::string, short> stateMap = {
-        {"AA", 0}, {"AK", 1}, {"AL", 2}, {"AP", 3}, {"AR", 4},
-        {"AZ", 5}, {"CA", 6}, {"CO", 7}, {"CT", 8}, {"DC", 9},
-        {"DE", 10}, {"FL", 11}, {"FM", 12}, {"GA", 13}, {"HI", 14},
-        {"IA", 15}, {"ID", 16}, {"IL", 17}, {"IN", 18}, {"KS", 19},
-        {"KY", 20}, {"LA", 21}, {"MA", 22}, {"MD", 23}, {"ME", 24},
-        {"MH", 25}, {"MI", 26}, {"MN", 27}, {"MO", 28}, {"MP", 29},
-        {"MS", 30}, {"MT", 31}, {"NC", 32}, {"ND", 33}, {"NE", 34},
-        {"NH", 35}, {"NJ", 36}, {"NM", 37}, {"NV", 38}, {"NY", 39},
-        {"OH", 40}, {"OK", 41}, {"OR", 42}, {"PA", 43}, {"PW", 44},
-        {"RI", 45}, {"SC", 46}, {"SD", 47}, {"TN", 48}, {"TX", 49},
-        {"UT", 50}, {"VA", 51}, {"VT", 52}, {"WA", 53}, {"WI", 54},
-        {"WV", 55}, {"WY", 56}
-    };
-
-    auto it = stateMap.find(stateCode);
-    if (it != stateMap.end()) {
-        return it->second;
-    }
-    else {
-        return -1;
-    }
-}
\ No newline at end of file
+short PrimaryIndex::stateSelector(string_view stateCode) {
+    return StateCodes::index(stateCode);
+}
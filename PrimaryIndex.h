@@ -11,68 +11,112 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <unordered_map>
 #include "LengthBuffer.h"
 #include "zipCode.h"
 #include "delimBuffer.h"
+#include "RowParser.h"
+#include "Arena.h"
+#include "StateCodes.h"
+#include "StateStats.h"
 
 struct IndexElement {
 
     int zip;
     unsigned long int offset;
+    bool deleted;       // tombstone: the record stays in the data file until compact
 };
 
+// Records of one state, stored in the ingest arena
+typedef vector<ZipCode, ArenaAllocator<ZipCode>> StateBucket;
+
 class PrimaryIndex {
 
 private:
 
-    string printTable(vector<vector<ZipCode>>&); // output data table
-
-    short stateSelector(const string& stateCode);    // return index of state with the given 2-letter code
-
-    short northest(vector<ZipCode>); // searches a given state to find the most northern zip code
-
-    short southest(vector<ZipCode>); // searches a given state to find the most southern zip code
+    short stateSelector(string_view stateCode);    // return index of state with the given 2-letter code
 
-    short eastest(vector<ZipCode>); // searches a given state to find the most eastern zip code
-
-    short westest(vector<ZipCode>); // searches a given state to find the most western zip code
-
-    string readIn(ifstream& inFile, vector<vector<ZipCode>>& states);
+    bool readIn(ifstream& inFile, vector<StateBucket>& states, string& headerData);
 
     unsigned long binarySearch(int target, int left, int right);
 
-    void transfer(vector<vector<ZipCode>>&, string);
+    void transfer(vector<StateBucket>&, string);
 
     string buildHeader(string);
 
     vector<IndexElement> index;
     int recordCount;
+    int deletedCount;
+    int staleCount;     // records in the data file replaced by a newer copy
+    string indexFileName, dataFileName;
     fstream dataFile, indexFile;    
 
 public:
 
-    PrimaryIndex(string indexFileName = "IndexFile.index", string dataFileName = "DataFile.licsv") { 
+    PrimaryIndex(string indexFileName = "IndexFile.index", string dataFileName = "data.txt")
+        : recordCount(0), deletedCount(0), staleCount(0), indexFileName(indexFileName), dataFileName(dataFileName) { 
         indexFile.open(indexFileName); dataFile.open(dataFileName); readIndex(); indexFile.close(); dataFile.close(); }
 
-    PrimaryIndex(ifstream& infile) { 
+    PrimaryIndex(ifstream& infile)
+        : recordCount(0), deletedCount(0), staleCount(0), indexFileName("IndexFile.index"), dataFileName("data.txt") { 
         readCSV(infile); }
 
     void add(int zipCode, unsigned long offset);
 
+    /*
+    * @brief Marks a zip code deleted
+    * @post The entry is kept as a tombstone, written to the index file with a ",D" field,
+    *       and its record stays in the data file until compact rewrites it.
+    *       Returns false if the zip code is not in the index or is already deleted.
+    */
+    bool remove(int zipCode);
+
+    /*
+    * @brief Tells whether a record can be written to the data file
+    * @post Returns false if its body is longer than the two-digit length can count.
+    */
+    static bool fits(const ZipCode& record);
+
+    /*
+    * @brief Appends new and changed records to the end of the data file
+    * @pre records are valid ZipCodes; a zip code that is already indexed is replaced
+    * @post Each record is written once, length indicated, and its entry points at it.
+    *       A replaced record, or the record of a deleted zip code added back, stays in
+    *       the data file until compact. The index file is not written.
+    *       Returns false, writing nothing, if any record does not fit.
+    */
+    bool append(const vector<ZipCode>& records);
+
+    /*
+    * @brief Rewrites the data file without the records of deleted zip codes
+    * @param maxDeletedShare Fraction of dead records tolerated before the data file is rewritten
+    * @post Does nothing and returns false while deleted and replaced records are at most
+    *       that share of the file. Otherwise the live records are copied in their file
+    *       order, the tombstones are dropped and the index file is written with the new
+    *       offsets. Replaced records are only counted when they were appended through
+    *       this object.
+    */
+    bool compact(double maxDeletedShare = 0.25);
+
     unsigned long search(int targetZipCode);
 
     void writeToFile();
 
     void readIndex();
 
-    void readCSV(ifstream&);
+    /*
+    * @brief Regenerates the data file and the index file from a CSV
+    * @post Returns false, leaving both files alone, if the header does not name every
+    *       zip code field.
+    */
+    bool readCSV(ifstream&);
 
     void getIndex(vector<IndexElement>& returnValue);
 
     int getSize() { 
         return index.size(); }
 
+    int getDeletedCount() { return deletedCount; }
+
     int getOffset(int i) { return index[i].offset; };
 
 };
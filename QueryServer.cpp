@@ -0,0 +1,367 @@
+/**
+ * @file QueryServer.cpp
+ * @brief Implementation of the QueryServer class.
+ */
+
+#include "QueryServer.h"
+#include "NumberCodec.h"
+#include "RecordCodec.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+QueryServer::QueryServer(BFile& file, const string& socketPath, int threads)
+    : file(file), primary("IndexFile.index", "data.txt"), socketPath(socketPath), threads(threads),
+      listenFd(-1), stopping(false), queries(0) {
+    wakePipe[0] = wakePipe[1] = -1;
+    if (this->threads <= 0)
+        this->threads = max(1u, thread::hardware_concurrency());
+}
+
+QueryServer::~QueryServer() {
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        unlink(socketPath.c_str());
+    }
+    if (wakePipe[0] >= 0) {
+        ::close(wakePipe[0]);
+        ::close(wakePipe[1]);
+    }
+}
+
+/**
+ * @brief Creates the socket and starts listening.
+ * @return True if the server is listening.
+ */
+bool QueryServer::start() {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+        return false;
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    if (pipe(wakePipe) != 0)
+        return false;
+    fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+        return false;
+    unlink(socketPath.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || listen(listenFd, 128) != 0) {
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Asks run to stop.
+ */
+void QueryServer::requestShutdown() {
+    stopping = true;
+    char wake = 1;
+    if (wakePipe[1] >= 0)
+        (void)!write(wakePipe[1], &wake, 1);
+}
+
+/**
+ * @brief Accepts connections and reads commands until a shutdown is requested.
+ */
+void QueryServer::run() {
+    for (int i = 0; i < threads; i++)
+        workers.emplace_back(&QueryServer::workerLoop, this);
+
+    vector<pollfd> watched;
+    vector<int> ready;
+    while (!stopping) {
+        watched.clear();
+        watched.push_back(pollfd{listenFd, POLLIN, 0});
+        watched.push_back(pollfd{wakePipe[0], POLLIN, 0});
+        for (const auto& entry : connections) {
+            if (!entry.second.busy)
+                watched.push_back(pollfd{entry.first, POLLIN, 0});
+        }
+
+        if (poll(watched.data(), watched.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (watched[1].revents != 0) {
+            char drained[64];
+            while (read(wakePipe[0], drained, sizeof(drained)) > 0)
+                ;
+            takeFinished();
+        }
+        if (stopping)
+            break;
+
+        // collected first, since accepting or closing changes the poll set
+        ready.clear();
+        for (size_t i = 2; i < watched.size(); i++) {
+            if (watched[i].revents != 0)
+                ready.push_back(watched[i].fd);
+        }
+        for (int fd : ready)
+            receive(connections.at(fd));
+
+        if (watched[0].revents & POLLIN) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                lock_guard<mutex> guard(queueLock);
+                connections.emplace(fd, Connection{fd, string(), false, true});
+            }
+        }
+    }
+
+    ::close(listenFd);
+    listenFd = -1;
+    unlink(socketPath.c_str());
+
+    // no more commands are read, but the ones already handed to workers are answered
+    {
+        lock_guard<mutex> guard(queueLock);
+        stopping = true;
+        queueReady.notify_all();
+    }
+    for (thread& worker : workers)
+        worker.join();
+    workers.clear();
+
+    finished.clear();
+    for (const auto& entry : connections)
+        ::close(entry.first);
+    {
+        lock_guard<mutex> guard(queueLock);
+        connections.clear();
+    }
+
+    file.flush();
+}
+
+// Reads what a readable connection has sent and queues it once a line is complete
+void QueryServer::receive(Connection& connection) {
+    char chunk[MaxLine];
+    ssize_t received = recv(connection.fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+    if (received < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+        return;
+    if (received <= 0) {
+        closeConnection(connection.fd);
+        return;
+    }
+    connection.input.append(chunk, received);
+
+    // an overlong line goes to a worker too, which answers it with an error
+    if (connection.input.find('\n') == string::npos && connection.input.size() <= MaxLine)
+        return;
+    connection.busy = true;
+    lock_guard<mutex> guard(queueLock);
+    pending.push_back(&connection);
+    queueReady.notify_one();
+}
+
+// Closes a connection that no worker holds
+void QueryServer::closeConnection(int fd) {
+    ::close(fd);
+    lock_guard<mutex> guard(queueLock);
+    connections.erase(fd);
+}
+
+// Polls the connections workers have answered again, or closes them if they ended
+void QueryServer::takeFinished() {
+    deque<Connection*> answered;
+    {
+        lock_guard<mutex> guard(queueLock);
+        answered.swap(finished);
+    }
+    for (Connection* connection : answered) {
+        connection->busy = false;
+        if (!connection->open)
+            closeConnection(connection->fd);
+    }
+}
+
+// Runs the complete lines of queued connections until the server stops
+void QueryServer::workerLoop() {
+    for (;;) {
+        Connection* connection;
+        {
+            unique_lock<mutex> lock(queueLock);
+            queueReady.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (pending.empty())
+                return;
+            connection = pending.front();
+            pending.pop_front();
+        }
+        connection->open = serve(*connection);
+        {
+            lock_guard<mutex> guard(queueLock);
+            finished.push_back(connection);
+        }
+        char wake = 0;
+        (void)!write(wakePipe[1], &wake, 1);
+    }
+}
+
+// Answers every complete line received so far with a single write
+bool QueryServer::serve(Connection& connection) {
+    string& input = connection.input;
+    string reply;
+    bool open = true;
+
+    size_t start = 0, end;
+    while (open && (end = input.find('\n', start)) != string::npos) {
+        string_view line(input.data() + start, end - start);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        if (!line.empty())
+            open = execute(line, reply);
+        start = end + 1;
+    }
+    input.erase(0, start);
+    if (open && input.size() > MaxLine) {
+        reply.append("ERR line too long\n");
+        open = false;
+    }
+
+    return sendAll(connection.fd, reply) && open;
+}
+
+bool QueryServer::sendAll(int fd, const string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+// Parses a whole argument as a zip code
+static bool parseZip(string_view text, int& zip) {
+    return NumberCodec::parseInt(text.data(), text.data() + text.size(), zip);
+}
+
+/**
+ * @brief Runs one command line and appends its reply.
+ * @param line The command, without its newline.
+ * @param reply Receives the reply lines.
+ * @return False if the connection should be closed.
+ */
+bool QueryServer::execute(string_view line, string& reply) {
+    queries++;
+    size_t space = line.find(' ');
+    string_view command = line.substr(0, space);
+    string_view argument = space == string_view::npos ? string_view() : line.substr(space + 1);
+    int zip;
+
+    if (command == "GET") {
+        ZipCode record;
+        if (!parseZip(argument, zip)) {
+            reply.append("ERR bad zip\n");
+            return true;
+        }
+        if (file.findRecord(zip, record)) {
+            reply.append("OK ");
+            CsvCodec::appendBody(record, reply);
+            reply.push_back('\n');
+        } else {
+            reply.append("NOTFOUND\n");
+        }
+    } else if (command == "RANGE") {
+        size_t split = argument.find(' ');
+        int low, high;
+        if (split == string_view::npos || !parseZip(argument.substr(0, split), low)
+            || !parseZip(argument.substr(split + 1), high)) {
+            reply.append("ERR bad range\n");
+            return true;
+        }
+        vector<ZipCode> records;
+        file.findRange(low, high, records);
+        reply.append("OK ");
+        NumberCodec::appendInt(reply, records.size());
+        reply.push_back('\n');
+        for (const ZipCode& record : records) {
+            CsvCodec::appendBody(record, reply);
+            reply.push_back('\n');
+        }
+    } else if (command == "ADD") {
+        ZipCode record, existing;
+        // decodeBody reads a zip code that is not a number as 0, so it is checked first
+        size_t comma = argument.find(',');
+        if (comma == string_view::npos || !parseZip(argument.substr(0, comma), zip)
+            || !CsvCodec::decodeBody(argument.data(), argument.size(), record)) {
+            reply.append("ERR bad record\n");
+            return true;
+        }
+        if (!PrimaryIndex::fits(record)) {
+            reply.append("ERR too long\n");
+            return true;
+        }
+        // addRecord refuses a zip code that is already there
+        unique_lock<mutex> writing(writeLock);
+        if (file.addRecord(record)) {
+            bool saved = primary.append({record});
+            if (saved)
+                primary.writeToFile();
+            writing.unlock();
+            reply.append(saved ? "OK\n" : "ERR not saved\n");
+        } else if (file.findRecord(record.getNum(), existing))
+            reply.append("EXISTS\n");
+        else
+            reply.append("ERR not added\n");
+    } else if (command == "DEL") {
+        if (!parseZip(argument, zip)) {
+            reply.append("ERR bad zip\n");
+            return true;
+        }
+        lock_guard<mutex> writing(writeLock);
+        if (file.deleteRecord(to_string(zip))) {
+            primary.remove(zip);
+            if (!primary.compact())
+                primary.writeToFile();
+            reply.append("OK\n");
+        } else {
+            reply.append("NOTFOUND\n");
+        }
+    } else if (command == "STATS") {
+        int records = file.getRecordCount();
+        int blocks = file.getBlockCount();
+        size_t open;
+        {
+            lock_guard<mutex> guard(queueLock);
+            open = connections.size();
+        }
+        reply.append("OK records=");
+        NumberCodec::appendInt(reply, records);
+        reply.append(" blocks=");
+        NumberCodec::appendInt(reply, blocks);
+        reply.append(" queries=");
+        NumberCodec::appendInt(reply, queries);
+        reply.append(" connections=");
+        NumberCodec::appendInt(reply, open);
+        reply.push_back('\n');
+    } else if (command == "QUIT") {
+        reply.append("OK\n");
+        return false;
+    } else if (command == "SHUTDOWN") {
+        reply.append("OK\n");
+        requestShutdown();
+        return false;
+    } else {
+        reply.append("ERR unknown command\n");
+    }
+    return true;
+}
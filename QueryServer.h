@@ -0,0 +1,128 @@
+/**
+ * @file QueryServer.h
+ * @brief Resident server that answers lookups and edits on a BFile over a Unix domain socket.
+ * @details The file and its indexes are built once and then serve every client. The
+ *          protocol is one command per line, answered in order:
+ *          - GET zip                   -> OK zip,city,state,county,lat,lon | NOTFOUND
+ *          - RANGE low high            -> OK n, then n record lines
+ *          - ADD zip,city,state,county,lat,lon -> OK | EXISTS | ERR
+ *          - DEL zip                   -> OK | NOTFOUND
+ *          - STATS                     -> OK records=.. blocks=.. queries=.. connections=..
+ *          - QUIT                      -> OK, then the connection closes
+ *          - SHUTDOWN                  -> OK, then the server stops
+ *          Clients may send many commands without waiting; every command that arrives in
+ *          one read is answered in one write. An ADD or DEL is written to the data file
+ *          and the primary index before it is answered, as the block file is rebuilt from
+ *          them when the program next starts.
+ *
+ *          One thread polls the listening socket and every idle connection. A connection
+ *          goes to the worker pool only once a complete line has arrived, so a client that
+ *          stays connected without sending holds no worker.
+ */
+
+#ifndef QUERYSERVER_H
+#define QUERYSERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "BFile.h"
+#include "PrimaryIndex.h"
+using namespace std;
+
+class QueryServer {
+public:
+    /**
+     * @brief Longest command line accepted, in bytes.
+     */
+    static const int MaxLine = 4096;
+
+    /**
+     * @brief Constructor for the QueryServer class.
+     * @param file The file to serve. It must outlive the server.
+     * @param socketPath Path of the Unix domain socket to listen on.
+     * @param threads Workers running commands at once; 0 means one per hardware thread.
+     *                Any number of connections may be open.
+     */
+    QueryServer(BFile& file, const string& socketPath, int threads = 0);
+
+    /**
+     * @brief Destructor. Stops the server if it is still running.
+     */
+    ~QueryServer();
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    /**
+     * @brief Creates the socket and starts listening.
+     * @post A stale socket file at the path is replaced. Returns false if the socket
+     *       could not be bound.
+     */
+    bool start();
+
+    /**
+     * @brief Accepts connections and reads commands until a shutdown is requested.
+     * @pre start returned true.
+     * @post Commands already received are answered, every worker has stopped, every
+     *       connection is closed, the socket file is removed and the BFile's header is
+     *       flushed.
+     */
+    void run();
+
+    /**
+     * @brief Asks run to stop.
+     * @details Only writes to a pipe, so it is safe to call from a signal handler.
+     */
+    void requestShutdown();
+
+    /**
+     * @brief Runs one command line and appends its reply.
+     * @return False if the connection should be closed after the reply.
+     */
+    bool execute(string_view line, string& reply);
+
+private:
+    /**
+     * @brief A client connection. While it waits in the poll set only run touches it;
+     *        while it is queued or being served only that worker does.
+     */
+    struct Connection {
+        int fd;
+        string input;      // bytes received but not yet run
+        bool busy;         // handed to the workers; not polled
+        bool open;         // false once a command or a failed send ended it
+    };
+
+    void receive(Connection& connection);
+    void closeConnection(int fd);
+    void takeFinished();
+    void workerLoop();
+    bool serve(Connection& connection);
+    static bool sendAll(int fd, const string& data);
+
+    BFile& file;               // safe to call from every worker at once
+    PrimaryIndex primary;      // IndexFile.index and data.txt, which the file is rebuilt from
+    mutex writeLock;           // keeps a change to file and to primary in the same order
+    string socketPath;
+    int threads;
+    int listenFd;
+    int wakePipe[2];
+    atomic<bool> stopping;
+    atomic<long> queries;
+
+    mutex queueLock;
+    condition_variable queueReady;
+    deque<Connection*> pending;    // connections with a complete line, waiting for a worker
+    deque<Connection*> finished;   // connections a worker has answered, for run to poll again
+    unordered_map<int, Connection> connections;   // changed only by run, under queueLock
+    vector<thread> workers;
+};
+
+#endif // QUERYSERVER_H
@@ -0,0 +1,146 @@
+/**
+ * @file ReadSnapshot.cpp
+ * @brief Implementation of the ReadSnapshot class.
+ */
+
+#include "ReadSnapshot.h"
+#include <algorithm>
+
+/**
+ * @brief Takes a snapshot of a file.
+ * @param file The file to read.
+ */
+ReadSnapshot::ReadSnapshot(BFile& file) : file(file) {
+    // between two writes the blocks, index and counts all describe the same file
+    lock_guard<mutex> guard(file.writeLock);
+    epoch = file.versions.pin();
+    firstRBN = file.firstRBN;
+    availableSpace = file.availableSpace;
+    totalBlocks = file.totalBlocks;
+    totalRecords = file.totalRecords;
+    index = file.blockIndex.GetEntries();
+    sort(index.begin(), index.end(),
+         [](const BlockIndexVariables& a, const BlockIndexVariables& b) { return a.zipCode < b.zipCode; });
+}
+
+/**
+ * @brief Releases the snapshot.
+ */
+ReadSnapshot::~ReadSnapshot() {
+    buffer.clear();
+    file.versions.unpin(epoch);
+}
+
+// Block that would hold a zip code, as BlockIndex::Search finds it, or 0
+int ReadSnapshot::search(int zip) const {
+    auto found = lower_bound(index.begin(), index.end(), zip,
+                             [](const BlockIndexVariables& entry, int key) { return entry.zipCode < key; });
+    return found == index.end() ? 0 : found->RBN;
+}
+
+// Loads a block as it was at the snapshot's epoch
+bool ReadSnapshot::readBlock(int rbn) {
+    // the latch keeps a writer from saving and overwriting the block while it is read
+    shared_lock<BlockLatch> latch(file.latches.get(rbn));
+    if (file.versions.find(rbn, epoch, image)) {
+        buffer.assign(image);
+        return true;
+    }
+    return buffer.read(file.fd, rbn);
+}
+
+/**
+ * @brief Finds a record as it was when the snapshot was taken.
+ * @param zip The zip code to look for.
+ * @param result Receives the record.
+ * @return True if the zip code was in the file.
+ */
+bool ReadSnapshot::findRecord(int zip, ZipCode& result) {
+    Block header;
+    ZipCodeView record;
+    int rbn = search(zip);
+
+    for (int visited = 0; rbn != 0 && visited < totalBlocks; visited++) {
+        if (!readBlock(rbn))
+            return false;
+        buffer.beginRecords(header);
+        if (header.getRecordCount() > 0 && zip <= header.getMaximumZip()) {
+            while (buffer.nextRecord(record)) {
+                if (record.getNum() == zip) {
+                    result = record.toZipCode();
+                    return true;
+                }
+                if (record.getNum() > zip)
+                    break;
+            }
+            return false;
+        }
+        rbn = header.getNextIndex();
+    }
+    return false;
+}
+
+/**
+ * @brief Finds every record in a range of zip codes.
+ * @param low The lowest zip code wanted.
+ * @param high The highest zip code wanted.
+ * @param result Receives copies of the records, in zip order.
+ * @return The number of records found.
+ */
+int ReadSnapshot::findRange(int low, int high, vector<ZipCode>& result) {
+    Block header;
+    ZipCodeView record;
+    int found = 0;
+    int rbn = search(low);
+
+    for (int visited = 0; rbn != 0 && visited < totalBlocks; visited++) {
+        if (!readBlock(rbn))
+            break;
+        buffer.beginRecords(header);
+        while (buffer.nextRecord(record)) {
+            if (record.getNum() > high)
+                return found;
+            if (record.getNum() >= low) {
+                result.push_back(record.toZipCode());
+                found++;
+            }
+        }
+        rbn = header.getNextIndex();
+    }
+    return found;
+}
+
+/**
+ * @brief Writes a logical dump of the snapshot.
+ * @param out The writer to stream to.
+ */
+void ReadSnapshot::logicalDump(DumpWriter& out) {
+    int rbn = firstRBN;
+    Block tempBlock;
+    ZipCodeView record;
+
+    out << "List Head: " << firstRBN;
+    out << "\nAvail Head: " << availableSpace;
+    out << "\n";
+
+    for (int i = 1; i <= totalBlocks; ++i) {
+        if (rbn == 0 || !readBlock(rbn)) break;
+        buffer.beginRecords(tempBlock);
+        tempBlock.setActiveState(tempBlock.getRecordCount() > 0);
+
+        if (tempBlock.isActive()) {
+            out << "RBN Prev: " << tempBlock.getPreviousIndex();
+
+            while (buffer.nextRecord(record)) {
+                out << record.getNum() << ' ';
+            }
+
+            out << "RBN Prev: " << tempBlock.getNextIndex() << '\n';
+            rbn = tempBlock.getNextIndex();
+        } else {
+            out << "RBN Prev:0\t*AVAILABLE*\tRBN Next: 0\n";
+        }
+    }
+    buffer.clear();
+    out.flush();
+}
@@ -0,0 +1,84 @@
+/**
+ * @file ReadSnapshot.h
+ * @brief A consistent, read-only view of a BFile as of the moment it was taken.
+ * @details Taking a snapshot waits for the write in progress, if any, to finish, then
+ *          pins the file's epoch and copies its block index and list head. Writers then
+ *          proceed as usual; the first time one overwrites a block after the snapshot, the
+ *          old image is kept in the BFile's VersionStore, and the snapshot reads that image
+ *          instead of the block on disk. Long scans and exports through a snapshot never
+ *          see half of a split or merge, and never make a writer wait.
+ */
+
+#ifndef READSNAPSHOT_H
+#define READSNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BFile.h"
+using namespace std;
+
+class ReadSnapshot {
+public:
+    /**
+     * @brief Takes a snapshot of a file.
+     * @param file The file; it must outlive the snapshot.
+     */
+    explicit ReadSnapshot(BFile& file);
+
+    /**
+     * @brief Releases the snapshot and the block images only it was using.
+     */
+    ~ReadSnapshot();
+
+    ReadSnapshot(const ReadSnapshot&) = delete;
+    ReadSnapshot& operator=(const ReadSnapshot&) = delete;
+
+    /**
+     * @brief Finds a record as it was when the snapshot was taken.
+     * @param zip The zip code to look for.
+     * @param result Receives a copy of the record.
+     * @return True if the zip code was in the file.
+     */
+    bool findRecord(int zip, ZipCode& result);
+
+    /**
+     * @brief Finds every record whose zip code is between low and high, inclusive.
+     * @param result Receives copies of the records, in zip order.
+     * @return The number of records found.
+     */
+    int findRange(int low, int high, vector<ZipCode>& result);
+
+    /**
+     * @brief Writes a logical dump of the file as it was when the snapshot was taken.
+     * @param out The writer to stream to.
+     */
+    void logicalDump(DumpWriter& out);
+
+    /**
+     * @brief Epoch of the file the snapshot shows.
+     */
+    uint64_t getEpoch() const { return epoch; }
+
+    int getRecordCount() const { return totalRecords; }
+
+    int getBlockCount() const { return totalBlocks; }
+
+    int getFirstRBN() const { return firstRBN; }
+
+private:
+    int search(int zip) const;
+    bool readBlock(int rbn);
+
+    BFile& file;
+    uint64_t epoch;
+    int firstRBN;
+    int availableSpace;
+    int totalBlocks;
+    int totalRecords;
+    vector<BlockIndexVariables> index;  // sorted by highest zip
+    BlockBuffer buffer;     // a snapshot is used by one thread at a time
+    string image;
+};
+
+#endif // READSNAPSHOT_H
@@ -0,0 +1,234 @@
+/**
+ * @file RecordCodec.h
+ * @brief Record encoder and decoder generated at compile time from a framing and a schema.
+ * @details A framing says how a record body is delimited inside a larger buffer; a schema
+ *          says which fields make up the body. RecordCodec<Framing, Schema> combines the
+ *          two into fully inlined encode and decode functions. Buffer_Record, LengthBuffer,
+ *          delimBuffer and BlockBuffer are thin wrappers over the instantiations below.
+ *
+ *          A framing provides:
+ *          - Delim and Quoted: the field delimiter and whether fields may be quoted.
+ *          - encodedSize(bodyLength): the size of a framed record.
+ *          - appendPrefix(out, bodyLength) and appendSuffix(out).
+ *          - locate(data, size, bodyStart, bodyLength): finds the body of the first
+ *            record in data and returns the bytes it occupies, or 0 if it is incomplete.
+ */
+
+#ifndef RECORDCODEC_H
+#define RECORDCODEC_H
+
+#include <string>
+#include <utility>
+#include "NumberCodec.h"
+#include "FieldScanner.h"
+#include "ZipCodeSchema.h"
+using namespace std;
+
+/**
+ * @brief CSV row: fields separated by commas, ended by a newline, quotes allowed.
+ */
+struct DelimitedFraming {
+    static const char Delim = ',';
+    static const bool Quoted = true;
+
+    static int encodedSize(int bodyLength) { return bodyLength + 1; }
+
+    static void appendPrefix(string&, int) {}
+
+    static void appendSuffix(string& out) { out.push_back('\n'); }
+
+    static int locate(const char* data, int size, int& bodyStart, int& bodyLength) {
+        int pos = 0;
+        while (true) {
+            int hit = FieldScanner::findSpecial(data, pos, size, Delim);
+            if (hit == size)
+                return 0;
+            if (data[hit] == '\n') {
+                bodyStart = 0;
+                bodyLength = hit;
+                return hit + 1;
+            }
+            if (data[hit] == '"')
+                hit = FieldScanner::findChar(data, hit + 1, size, '"');
+            if (hit == size)
+                return 0;
+            pos = hit + 1;
+        }
+    }
+};
+
+/**
+ * @brief Length-indicated record of the data file: two ASCII digits giving the body
+ *        length, then the body. A body longer than MaxBody cannot be framed.
+ */
+struct LengthFraming {
+    static const char Delim = ',';
+    static const bool Quoted = false;
+    static const int PrefixDigits = 2;
+    static const int MaxBody = 99;      // the most two digits can count
+
+    static int encodedSize(int bodyLength) { return PrefixDigits + bodyLength; }
+
+    static void appendPrefix(string& out, int bodyLength) {
+        if (bodyLength < 10)
+            out.push_back('0');
+        NumberCodec::appendInt(out, bodyLength);
+    }
+
+    static void appendSuffix(string&) {}
+
+    static int locate(const char* data, int size, int& bodyStart, int& bodyLength) {
+        if (size < PrefixDigits || !NumberCodec::parseInt(data, data + PrefixDigits, bodyLength))
+            return 0;
+        if (PrefixDigits + bodyLength > size)
+            return 0;
+        bodyStart = PrefixDigits;
+        return PrefixDigits + bodyLength;
+    }
+};
+
+/**
+ * @brief Record embedded in a block: an ASCII count, a comma, then the body. The count
+ *        is the body length plus three, as blocks have always been written.
+ */
+struct BlockFraming {
+    static const char Delim = ',';
+    static const bool Quoted = false;
+    static const int CountBias = 3;
+
+    static int encodedSize(int bodyLength) {
+        return NumberCodec::intLength(bodyLength + CountBias) + 1 + bodyLength;
+    }
+
+    static void appendPrefix(string& out, int bodyLength) {
+        NumberCodec::appendInt(out, bodyLength + CountBias);
+        out.push_back(Delim);
+    }
+
+    static void appendSuffix(string&) {}
+
+    static int locate(const char* data, int size, int& bodyStart, int& bodyLength) {
+        int comma = FieldScanner::findChar(data, 0, size, Delim);
+        if (comma == size || !NumberCodec::parseInt(data, data + comma, bodyLength))
+            return 0;
+        bodyLength -= CountBias;
+        bodyStart = comma + 1;
+        if (bodyLength < 0 || bodyStart + bodyLength > size)
+            return 0;
+        return bodyStart + bodyLength;
+    }
+};
+
+template <class Framing, class Schema = ZipCodeSchema>
+class RecordCodec {
+public:
+    typedef typename Schema::Record Record;
+
+    /**
+     * @brief Length of the record's fields and separators, without framing.
+     */
+    static int bodyLength(const Record& r) {
+        return bodyLength(r, make_index_sequence<Schema::FieldCount>());
+    }
+
+    /**
+     * @brief Length of the record once framed.
+     */
+    static int encodedSize(const Record& r) {
+        return Framing::encodedSize(bodyLength(r));
+    }
+
+    /**
+     * @brief Appends the record's fields and separators, without framing.
+     */
+    static void appendBody(const Record& r, string& out) {
+        appendBody(r, out, make_index_sequence<Schema::FieldCount>());
+    }
+
+    /**
+     * @brief Appends the framed record.
+     */
+    static void encode(const Record& r, string& out) {
+        Framing::appendPrefix(out, bodyLength(r));
+        appendBody(r, out);
+        Framing::appendSuffix(out);
+    }
+
+    /**
+     * @brief Parses a record body into r.
+     * @post Returns false if the body ran out before the last field.
+     */
+    static bool decodeBody(const char* body, int length, Record& r) {
+        return decodeBody(body, length, r, make_index_sequence<Schema::FieldCount>());
+    }
+
+    /**
+     * @brief Parses the first framed record of data into r.
+     * @post Returns the bytes the record occupies, or 0 if data does not hold a whole record.
+     */
+    static int decode(const char* data, int size, Record& r) {
+        int bodyStart, length;
+        int used = Framing::locate(data, size, bodyStart, length);
+        if (used != 0)
+            decodeBody(data + bodyStart, length, r);
+        return used;
+    }
+
+    /**
+     * @brief Locates the field that starts at pos and advances pos past its delimiter.
+     * @pre delim is the framing's delimiter unless a buffer was built with another one.
+     * @post start and length describe the field text without quotes. Returns false if
+     *       pos was already past the end of the body.
+     */
+    static bool nextField(const char* body, int size, int& pos, int& start, int& length,
+                          char delim = Framing::Delim) {
+        if (pos > size)
+            return false;
+        int end;
+        if (Framing::Quoted && pos < size && body[pos] == '"') {
+            start = pos + 1;
+            end = FieldScanner::findChar(body, start, size, '"');
+            pos = FieldScanner::findChar(body, end < size ? end + 1 : size, size, delim) + 1;
+        } else {
+            start = pos;
+            end = FieldScanner::findChar(body, pos, size, delim);
+            pos = end + 1;
+        }
+        length = end - start;
+        return true;
+    }
+
+private:
+    template <size_t... I>
+    static int bodyLength(const Record& r, index_sequence<I...>) {
+        return (Schema::template Field<I>::length(r) + ...) + Schema::FieldCount - 1;
+    }
+
+    template <size_t... I>
+    static void appendBody(const Record& r, string& out, index_sequence<I...>) {
+        ((I == 0 ? void() : out.push_back(Framing::Delim), Schema::template Field<I>::append(out, r)), ...);
+    }
+
+    template <size_t I>
+    static bool decodeField(const char* body, int size, int& pos, Record& r) {
+        int start, length;
+        if (!nextField(body, size, pos, start, length))
+            return false;
+        Schema::template Field<I>::set(r, body + start, length);
+        return true;
+    }
+
+    template <size_t... I>
+    static bool decodeBody(const char* body, int size, Record& r, index_sequence<I...>) {
+        int pos = 0;
+        return (decodeField<I>(body, size, pos, r) && ...);
+    }
+};
+
+typedef RecordCodec<DelimitedFraming> CsvCodec;
+typedef RecordCodec<LengthFraming> LengthCodec;
+typedef RecordCodec<BlockFraming> BlockRecordCodec;
+typedef RecordCodec<LengthFraming, ZipCodeViewSchema> LengthViewCodec;
+typedef RecordCodec<BlockFraming, ZipCodeViewSchema> BlockViewCodec;
+
+#endif // RECORDCODEC_H
@@ -0,0 +1,129 @@
+/**
+ * @file RowParser.cpp
+ * @brief Implementation of the RowParser class.
+ * @details The header is matched against known column names once. Every later row is
+ *          split into spans and each span is handed to the setter bound to its column,
+ *          so no column names are compared while rows are parsed.
+ */
+
+#include "RowParser.h"
+#include "NumberCodec.h"
+#include <cctype>
+
+// Setters, one per ZipField, in enum order
+static void setZip(ZipCode& z, const char* text, int length) {
+    z.setNum(NumberCodec::toInt(text, length));
+}
+
+static void setCity(ZipCode& z, const char* text, int length) {
+    z.setCity(string_view(text, length));
+}
+
+static void setState(ZipCode& z, const char* text, int length) {
+    z.setStateCode(string_view(text, length));
+}
+
+static void setCounty(ZipCode& z, const char* text, int length) {
+    z.setCounty(string_view(text, length));
+}
+
+static void setLat(ZipCode& z, const char* text, int length) {
+    z.setLatMicro(NumberCodec::toFixed6(text, length));
+}
+
+static void setLon(ZipCode& z, const char* text, int length) {
+    z.setLonMicro(NumberCodec::toFixed6(text, length));
+}
+
+static void skipColumn(ZipCode&, const char*, int) {
+}
+
+/**
+ * @brief Header names accepted for each field, after lowercasing and dropping non-letters.
+ */
+static const struct {
+    const char* name;
+    ZipField field;
+} columnNames[] = {
+    {"zipcode", FIELD_ZIP},     {"zip", FIELD_ZIP},       {"postalcode", FIELD_ZIP},
+    {"placename", FIELD_CITY},  {"city", FIELD_CITY},     {"place", FIELD_CITY},
+    {"state", FIELD_STATE},     {"statecode", FIELD_STATE},
+    {"county", FIELD_COUNTY},
+    {"lat", FIELD_LAT},         {"latitude", FIELD_LAT},
+    {"long", FIELD_LON},        {"lon", FIELD_LON},       {"lng", FIELD_LON},  {"longitude", FIELD_LON}
+};
+
+/**
+ * @brief Resolves a header line into a column to field mapping.
+ * @param headerData The header line.
+ * @return True if every ZipCode field was found in the header.
+ */
+bool RowParser::resolveHeader(const string& headerData) {
+    static const FieldSetter setterTable[] = {
+        setZip, setCity, setState, setCounty, setLat, setLon, skipColumn
+    };
+
+    fields.clear();
+    setters.clear();
+    required = 0;
+
+    FieldScanner::split(headerData, delim, spans);
+
+    bool found[FIELD_IGNORED] = {};
+    for (size_t column = 0; column < spans.size(); column++) {
+        string name;
+        for (int i = 0; i < spans[column].length; i++) {
+            char c = headerData[spans[column].start + i];
+            if (isalpha(static_cast<unsigned char>(c)))
+                name.push_back(tolower(static_cast<unsigned char>(c)));
+        }
+
+        ZipField field = FIELD_IGNORED;
+        for (const auto& entry : columnNames) {
+            if (name == entry.name) {
+                field = entry.field;
+                break;
+            }
+        }
+        if (field != FIELD_IGNORED) {
+            if (found[field])
+                field = FIELD_IGNORED; // the first column with a name wins
+            else {
+                found[field] = true;
+                required = column + 1;
+            }
+        }
+
+        fields.push_back(field);
+        setters.push_back(setterTable[field]);
+    }
+
+    for (int i = 0; i < FIELD_IGNORED; i++) {
+        if (!found[i])
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Parses one data row into a ZipCode.
+ * @param row The row text, without its newline.
+ * @param zip The record to fill in.
+ * @return True if the row reached every mapped column.
+ */
+bool RowParser::parse(const string& row, ZipCode& zip) {
+    FieldScanner::split(row, delim, spans);
+    if (spans.size() < required)
+        return false;
+
+    const char* text = row.data();
+    for (size_t column = 0; column < required; column++) {
+        if (spans[column].escaped) {
+            FieldScanner::unescape(text, spans[column], unescaped);
+            setters[column](zip, unescaped.data(), unescaped.size());
+        } else {
+            setters[column](zip, text + spans[column].start, spans[column].length);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file RowParser.h
+ * @brief Table-driven parser that maps CSV columns straight onto ZipCode fields.
+ */
+
+#ifndef ROWPARSER_H
+#define ROWPARSER_H
+
+#include <string>
+#include <vector>
+#include "zipCode.h"
+#include "FieldScanner.h"
+using namespace std;
+
+/**
+ * @brief The ZipCode field a CSV column feeds.
+ */
+enum ZipField {
+    FIELD_ZIP,
+    FIELD_CITY,
+    FIELD_STATE,
+    FIELD_COUNTY,
+    FIELD_LAT,
+    FIELD_LON,
+    FIELD_IGNORED
+};
+
+class RowParser {
+public:
+    /**
+     * @brief Constructor for the RowParser class.
+     * @post The parser has no columns until a header is resolved.
+     */
+    RowParser(char delim = ',') : delim(delim), required(0) {}
+
+    /**
+     * @brief Resolves a header line into a column to field mapping.
+     * @pre headerData holds the column names separated by the delimiter. Case, quotes
+     *      and non-letter characters in the names are ignored.
+     * @post Each column is bound to the setter for its field; unknown columns are skipped.
+     *       Returns true if every ZipCode field was found.
+     */
+    bool resolveHeader(const string& headerData);
+
+    /**
+     * @brief Parses one data row into a ZipCode.
+     * @pre resolveHeader has been called.
+     * @post The mapped fields of zip are overwritten. Returns false if the row has too
+     *       few columns to reach every mapped field.
+     */
+    bool parse(const string& row, ZipCode& zip);
+
+    /**
+     * @brief Gives the field bound to a column.
+     */
+    ZipField getField(int column) const { return fields[column]; }
+
+    /**
+     * @brief Gives the number of columns in the resolved header.
+     */
+    int getColumnCount() const { return fields.size(); }
+
+private:
+    typedef void (*FieldSetter)(ZipCode&, const char*, int);
+
+    char delim;
+    size_t required;             // columns a row needs to reach the last mapped field
+    vector<ZipField> fields;     // field bound to each column
+    vector<FieldSetter> setters; // setter bound to each column
+    vector<FieldSpan> spans;     // reused across rows
+    string unescaped;            // a quoted field with "" pairs, collapsed
+};
+
+#endif // ROWPARSER_H
@@ -0,0 +1,209 @@
+/**
+ * @file SharedIndex.cpp
+ * @brief Implementation of the SharedIndex class.
+ */
+
+#include "SharedIndex.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char ControlMagic[8] = {'Z', 'I', 'P', 'S', 'H', 'A', 'R', 'E'};
+
+SharedIndex::SharedIndex() : control(nullptr), segment(nullptr), segmentSize(0), version(0) {}
+
+SharedIndex::~SharedIndex() {
+    detach();
+}
+
+string SharedIndex::segmentName(const string& name, uint64_t version) {
+    return "/" + name + "." + to_string(version);
+}
+
+/**
+ * @brief Publishes an image as the next version.
+ * @param name The publication name.
+ * @param image The image bytes.
+ * @param size The number of bytes.
+ * @return True if the image is now the current version.
+ */
+bool SharedIndex::publish(const string& name, const void* image, size_t size) {
+    DatabaseImage check;
+    if (!check.attach(image, size))
+        return false;
+
+    string controlName = "/" + name;
+    int controlFd = shm_open(controlName.c_str(), O_RDWR | O_CREAT, 0644);
+    if (controlFd < 0)
+        return false;
+    // one publisher at a time; readers never take this lock
+    flock(controlFd, LOCK_EX);
+
+    struct stat info;
+    void* mapped = MAP_FAILED;
+    if (fstat(controlFd, &info) == 0
+        && (info.st_size >= static_cast<off_t>(sizeof(Control)) || ftruncate(controlFd, sizeof(Control)) == 0))
+        mapped = mmap(nullptr, sizeof(Control), PROT_READ | PROT_WRITE, MAP_SHARED, controlFd, 0);
+    if (mapped == MAP_FAILED) {
+        flock(controlFd, LOCK_UN);
+        close(controlFd);
+        return false;
+    }
+    Control* ctl = static_cast<Control*>(mapped);
+    if (memcmp(ctl->magic, ControlMagic, sizeof(ControlMagic)) != 0) {
+        // a new control segment is zero-filled, which is version 0
+        memcpy(ctl->magic, ControlMagic, sizeof(ControlMagic));
+    }
+
+    uint64_t current = ctl->version.load(memory_order_acquire);
+    uint64_t next = current + 1;
+    string nextName = segmentName(name, next);
+    shm_unlink(nextName.c_str());     // left over by a publisher that died before switching
+
+    bool published = false;
+    int fd = shm_open(nextName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd >= 0) {
+        void* data = MAP_FAILED;
+        if (ftruncate(fd, size) == 0)
+            data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data != MAP_FAILED) {
+            memcpy(data, image, size);
+            munmap(data, size);
+            // the image is complete before any reader can learn its version
+            ctl->version.store(next, memory_order_release);
+            if (current != 0)
+                shm_unlink(segmentName(name, current).c_str());
+            published = true;
+        } else {
+            shm_unlink(nextName.c_str());
+        }
+    }
+
+    munmap(mapped, sizeof(Control));
+    flock(controlFd, LOCK_UN);
+    close(controlFd);
+    return published;
+}
+
+/**
+ * @brief Publishes an image file as the next version.
+ * @param name The publication name.
+ * @param imagePath The image file.
+ * @return True if the image is now the current version.
+ */
+bool SharedIndex::publishFile(const string& name, const string& imagePath) {
+    ifstream in(imagePath, ios::binary);
+    if (!in.is_open())
+        return false;
+    string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    return publish(name, bytes.data(), bytes.size());
+}
+
+/**
+ * @brief Removes the control segment and the current image.
+ * @param name The publication name.
+ */
+void SharedIndex::remove(const string& name) {
+    SharedIndex reader;
+    if (reader.attach(name))
+        shm_unlink(segmentName(name, reader.getVersion()).c_str());
+    shm_unlink(("/" + name).c_str());
+}
+
+/**
+ * @brief Maps the current version of a publication.
+ * @param name The publication name.
+ * @return True if an image is mapped.
+ */
+bool SharedIndex::attach(const string& name) {
+    detach();
+    this->name = name;
+
+    int fd = shm_open(("/" + name).c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    void* mapped = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size >= static_cast<off_t>(sizeof(Control)))
+        mapped = mmap(nullptr, sizeof(Control), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+        return false;
+
+    control = static_cast<const Control*>(mapped);
+    if (memcmp(control->magic, ControlMagic, sizeof(ControlMagic)) != 0) {
+        detach();
+        return false;
+    }
+    return refresh();
+}
+
+/**
+ * @brief Moves to the newest published version.
+ * @return True if an image is mapped.
+ */
+bool SharedIndex::refresh() {
+    if (control == nullptr)
+        return false;
+
+    uint64_t latest = control->version.load(memory_order_acquire);
+    while (latest != 0 && latest != version) {
+        if (mapVersion(latest))
+            return true;
+        // the segment was unlinked by a newer publish between the load and the open
+        uint64_t newer = control->version.load(memory_order_acquire);
+        if (newer == latest)
+            break;
+        latest = newer;
+    }
+    return image.isOpen();
+}
+
+// Maps one version and, if it is a valid image, releases the previous one
+bool SharedIndex::mapVersion(uint64_t newVersion) {
+    int fd = shm_open(segmentName(name, newVersion).c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    if (!image.attach(data, info.st_size)) {
+        munmap(data, info.st_size);
+        if (segment != nullptr)
+            image.attach(segment, segmentSize);    // keep serving the version we had
+        return false;
+    }
+    if (segment != nullptr)
+        munmap(segment, segmentSize);
+    segment = data;
+    segmentSize = info.st_size;
+    version = newVersion;
+    return true;
+}
+
+/**
+ * @brief Unmaps the image and the control segment.
+ */
+void SharedIndex::detach() {
+    image.close();
+    if (segment != nullptr)
+        munmap(segment, segmentSize);
+    if (control != nullptr)
+        munmap(const_cast<Control*>(control), sizeof(Control));
+    segment = nullptr;
+    segmentSize = 0;
+    control = nullptr;
+    version = 0;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file SharedIndex.h
+ * @brief Publishes a DatabaseImage in POSIX shared memory so concurrent processes look up
+ *        zip codes from one copy of the index.
+ * @details A publication named N uses two segments:
+ *          - /N, a small control segment holding the current version number
+ *          - /N.<version>, the image of that version
+ *          A writer copies a new image into /N.<version+1>, then stores the new version in
+ *          the control segment and unlinks the old image. Readers map the image read-only;
+ *          refresh moves them to a newer version. A reader that is still mapping an
+ *          unlinked image keeps it until it moves on, so a publish never pulls pages out
+ *          from under a lookup.
+ */
+
+#ifndef SHAREDINDEX_H
+#define SHAREDINDEX_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "DatabaseImage.h"
+using namespace std;
+
+class SharedIndex {
+public:
+    SharedIndex();
+    ~SharedIndex();
+
+    SharedIndex(const SharedIndex&) = delete;
+    SharedIndex& operator=(const SharedIndex&) = delete;
+
+    /**
+     * @brief Publishes an image as the next version.
+     * @param name The publication name, without slashes.
+     * @param image The image bytes, as written by DatabaseImage::write.
+     * @post Publishers of the same name are serialized. Returns false, leaving the
+     *       current version in place, if the bytes are not a valid image or the segment
+     *       could not be created.
+     */
+    static bool publish(const string& name, const void* image, size_t size);
+
+    /**
+     * @brief Publishes an image file as the next version.
+     */
+    static bool publishFile(const string& name, const string& imagePath);
+
+    /**
+     * @brief Removes the control segment and the current image.
+     * @post Attached readers keep their mapping; later attach calls fail.
+     */
+    static void remove(const string& name);
+
+    /**
+     * @brief Maps the current version of a publication read-only.
+     * @return False if nothing is published under the name.
+     */
+    bool attach(const string& name);
+
+    /**
+     * @brief Moves to the newest published version if it has changed.
+     * @post Views into the previous image are no longer valid if the version changed.
+     *       Returns false if no version could be mapped.
+     */
+    bool refresh();
+
+    /**
+     * @brief Unmaps the image and the control segment.
+     */
+    void detach();
+
+    bool isAttached() const { return image.isOpen(); }
+
+    /**
+     * @brief Version of the mapped image.
+     */
+    uint64_t getVersion() const { return version; }
+
+    /**
+     * @brief The mapped image.
+     * @pre isAttached().
+     */
+    const DatabaseImage& getImage() const { return image; }
+
+private:
+    // Contents of the control segment
+    struct Control {
+        char magic[8];
+        atomic<uint64_t> version;    // 0 until the first publish
+    };
+
+    static_assert(atomic<uint64_t>::is_always_lock_free, "the version must be lock-free across processes");
+
+    static string segmentName(const string& name, uint64_t version);
+    bool mapVersion(uint64_t newVersion);
+
+    string name;
+    const Control* control;
+    DatabaseImage image;
+    void* segment;
+    size_t segmentSize;
+    uint64_t version;
+};
+
+#endif // SHAREDINDEX_H
@@ -0,0 +1,69 @@
+/**
+ * @file StateCodes.cpp
+ * @brief Implementation of the StateCodes class.
+ */
+
+#include "StateCodes.h"
+#include <algorithm>
+#include <mutex>
+#include <string>
+
+// The fixed table, in index order. It is sorted, so lookups are a binary search.
+static const string_view KnownCodes[StateCodes::NumStates] = {
+    "AA", "AK", "AL", "AP", "AR", "AZ", "CA", "CO", "CT", "DC",
+    "DE", "FL", "FM", "GA", "HI", "IA", "ID", "IL", "IN", "KS",
+    "KY", "LA", "MA", "MD", "ME", "MH", "MI", "MN", "MO", "MP",
+    "MS", "MT", "NC", "ND", "NE", "NH", "NJ", "NM", "NV", "NY",
+    "OH", "OK", "OR", "PA", "PW", "RI", "SC", "SD", "TN", "TX",
+    "UT", "VA", "VT", "WA", "WI", "WV", "WY"
+};
+
+// Codes outside the fixed table, stored from id NumStates up
+static mutex extraLock;
+static string extraCodes[StateCodes::NoState - StateCodes::NumStates];
+static int extraCount = 0;
+
+short StateCodes::index(string_view code) {
+    const string_view* end = KnownCodes + NumStates;
+    const string_view* it = lower_bound(KnownCodes, end, code);
+    if (it != end && *it == code)
+        return it - KnownCodes;
+    return -1;
+}
+
+/**
+ * @brief Gives the one-byte id of a state code.
+ * @param code The state code.
+ * @return The id of code, or NoState.
+ */
+uint8_t StateCodes::intern(string_view code) {
+    if (code.empty())
+        return NoState;
+    short known = index(code);
+    if (known >= 0)
+        return known;
+
+    lock_guard<mutex> guard(extraLock);
+    for (int i = 0; i < extraCount; i++) {
+        if (extraCodes[i] == code)
+            return NumStates + i;
+    }
+    if (extraCount == NoState - NumStates)
+        return NoState;
+    extraCodes[extraCount] = string(code);
+    return NumStates + extraCount++;
+}
+
+/**
+ * @brief Gives the code for an id returned by intern.
+ * @param id The id.
+ * @return The code, or an empty view for NoState.
+ */
+string_view StateCodes::code(uint8_t id) {
+    if (id < NumStates)
+        return KnownCodes[id];
+    if (id == NoState)
+        return string_view();
+    lock_guard<mutex> guard(extraLock);
+    return extraCodes[id - NumStates];
+}
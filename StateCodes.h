@@ -0,0 +1,45 @@
+/**
+ * @file StateCodes.h
+ * @brief Table of two-letter state codes and their one-byte indexes.
+ */
+
+#ifndef STATECODES_H
+#define STATECODES_H
+
+#include <cstdint>
+#include <string_view>
+using namespace std;
+
+class StateCodes {
+public:
+    /**
+     * @brief Number of states and regions in the fixed table.
+     */
+    static const short NumStates = 57;
+
+    /**
+     * @brief Index used for a record with no state code.
+     */
+    static const uint8_t NoState = 255;
+
+    /**
+     * @brief Gives the table index of a state code.
+     * @post Returns 0 to NumStates - 1, or -1 if the code is not in the fixed table.
+     */
+    static short index(string_view code);
+
+    /**
+     * @brief Gives the one-byte id of a state code.
+     * @post Codes in the fixed table get their table index. Other codes get ids from
+     *       NumStates up, assigned the first time they are seen. Returns NoState for an
+     *       empty code or when every id is taken.
+     */
+    static uint8_t intern(string_view code);
+
+    /**
+     * @brief Gives the code for an id returned by intern.
+     */
+    static string_view code(uint8_t id);
+};
+
+#endif // STATECODES_H
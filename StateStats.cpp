@@ -0,0 +1,102 @@
+/**
+ * @file StateStats.cpp
+ * @brief Implementation of the StateStats class.
+ */
+
+#include "StateStats.h"
+#include "NumberCodec.h"
+
+StateStats::StateStats() {
+    for (StateSummary& summary : summaries)
+        summary = StateSummary();
+}
+
+/**
+ * @brief Adds a record to the aggregates of its state.
+ * @param zip The record.
+ */
+void StateStats::add(const ZipCode& zip) {
+    int state = zip.getStateIndex();
+    if (state >= StateCodes::NumStates)
+        return;
+
+    StateSummary& s = summaries[state];
+    int num = zip.getNum();
+    int lat = zip.getLatMicro();
+    int lon = zip.getLonMicro();
+    if (s.count == 0) {
+        s.northZip = s.southZip = s.eastZip = s.westZip = num;
+        s.northLat = s.southLat = lat;
+        s.eastLon = s.westLon = lon;
+        s.minZip = s.maxZip = num;
+        s.count = 1;
+        return;
+    }
+
+    // strict comparisons keep the earlier record on a tie
+    if (lat > s.northLat) { s.northLat = lat; s.northZip = num; }
+    if (lat < s.southLat) { s.southLat = lat; s.southZip = num; }
+    if (lon > s.eastLon) { s.eastLon = lon; s.eastZip = num; }
+    if (lon < s.westLon) { s.westLon = lon; s.westZip = num; }
+    if (num < s.minZip) s.minZip = num;
+    if (num > s.maxZip) s.maxZip = num;
+    s.count++;
+}
+
+/**
+ * @brief Adds the aggregates of later records.
+ * @param other The aggregates to add.
+ */
+void StateStats::merge(const StateStats& other) {
+    for (int i = 0; i < StateCodes::NumStates; i++) {
+        StateSummary& s = summaries[i];
+        const StateSummary& o = other.summaries[i];
+        if (o.count == 0)
+            continue;
+        if (s.count == 0) {
+            s = o;
+            continue;
+        }
+        if (o.northLat > s.northLat) { s.northLat = o.northLat; s.northZip = o.northZip; }
+        if (o.southLat < s.southLat) { s.southLat = o.southLat; s.southZip = o.southZip; }
+        if (o.eastLon > s.eastLon) { s.eastLon = o.eastLon; s.eastZip = o.eastZip; }
+        if (o.westLon < s.westLon) { s.westLon = o.westLon; s.westZip = o.westZip; }
+        if (o.minZip < s.minZip) s.minZip = o.minZip;
+        if (o.maxZip > s.maxZip) s.maxZip = o.maxZip;
+        s.count += o.count;
+    }
+}
+
+/**
+ * @brief Gives the table of extreme zip codes.
+ * @return The table text, without a trailing newline.
+ */
+string StateStats::printTable() const {
+    string output;
+
+    output.append("*****************************************************\n");
+    output.append("*State\t|East\t\t|West\t\t|North\t\t|South\t*\n");
+    output.append("*****************************************************\n");
+
+    for (int i = 0; i < StateCodes::NumStates; i++) {
+        const StateSummary& s = summaries[i];
+        if (s.count == 0)
+            continue;
+        output.append("*");
+        output.append(StateCodes::code(i));
+        output.append("\t|");
+        NumberCodec::appendInt(output, s.eastZip);
+        output.append("\t\t|");
+        NumberCodec::appendInt(output, s.westZip);
+        output.append("\t\t|");
+        NumberCodec::appendInt(output, s.northZip);
+        output.append("\t\t|");
+        NumberCodec::appendInt(output, s.southZip);
+        output.append("\t*\n");
+    }
+    output.append("*****************************************************\n");
+    output.append("*State\t|East\t\t|West\t\t|North\t\t|South\t*\n");
+    output.append("*****************************************************");
+
+    return output;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file StateStats.h
+ * @brief Per-state aggregates: record counts and the extreme zip codes of each state.
+ */
+
+#ifndef STATESTATS_H
+#define STATESTATS_H
+
+#include <cstdint>
+#include <string>
+#include "StateCodes.h"
+#include "zipCode.h"
+using namespace std;
+
+/**
+ * @brief Aggregates of one state. Plain data, so it can be stored verbatim in an image
+ *        or a cache file. Coordinates are micro-degrees.
+ */
+struct StateSummary {
+    int32_t count;
+    int32_t northZip, southZip, eastZip, westZip;
+    int32_t northLat, southLat, eastLon, westLon;
+    int32_t minZip, maxZip;
+};
+
+class StateStats {
+public:
+    /**
+     * @brief Constructor for the StateStats class.
+     * @post Every state has a count of 0.
+     */
+    StateStats();
+
+    /**
+     * @brief Adds a record to the aggregates of its state.
+     * @post Records whose state is not in the StateCodes table are ignored. On a tie the
+     *       record added first stays the extreme.
+     */
+    void add(const ZipCode& zip);
+
+    /**
+     * @brief Adds the aggregates of another set of records, for example one gathered
+     *        by another thread.
+     * @pre other's records come after this one's, so ties still favour the earlier record.
+     */
+    void merge(const StateStats& other);
+
+    /**
+     * @brief Gives the aggregates of a state.
+     * @pre 0 <= state < StateCodes::NumStates.
+     */
+    const StateSummary& get(int state) const { return summaries[state]; }
+
+    /**
+     * @brief Replaces the aggregates of a state, as read back from an image or cache.
+     */
+    void set(int state, const StateSummary& summary) { summaries[state] = summary; }
+
+    /**
+     * @brief Gives the table of extreme zip codes of every state that has records.
+     */
+    string printTable() const;
+
+private:
+    StateSummary summaries[StateCodes::NumStates];
+};
+
+#endif // STATESTATS_H
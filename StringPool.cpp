@@ -0,0 +1,80 @@
+/**
+ * @file StringPool.cpp
+ * @brief Implementation of the StringPool class.
+ */
+
+#include "StringPool.h"
+#include <mutex>
+
+// Segment that holds id, and the id's place in it
+static inline void locate(uint32_t id, uint32_t first, int& segment, uint32_t& offset) {
+    segment = 31 - __builtin_clz(id / first + 1);
+    offset = id - first * ((1u << segment) - 1);
+}
+
+StringPool::StringPool() : count(0) {
+    for (atomic<string_view*>& segment : segments)
+        segment.store(nullptr, memory_order_relaxed);
+    intern(string_view());
+}
+
+StringPool::~StringPool() {
+    for (atomic<string_view*>& segment : segments)
+        delete[] segment.load(memory_order_relaxed);
+}
+
+StringPool& StringPool::shared() {
+    static StringPool pool;
+    return pool;
+}
+
+/**
+ * @brief Gives the id of a string, adding it if it is new.
+ * @param text The string to intern.
+ * @return The id of text.
+ */
+uint32_t StringPool::intern(string_view text) {
+    {
+        shared_lock<shared_mutex> reading(lock);
+        auto it = ids.find(text);
+        if (it != ids.end())
+            return it->second;
+    }
+
+    unique_lock<shared_mutex> writing(lock);
+    auto it = ids.find(text);      // another thread may have added it in between
+    if (it != ids.end())
+        return it->second;
+
+    uint32_t id = strings.size();
+    strings.emplace_back(text);
+    ids.emplace(string_view(strings.back()), id);
+
+    int segment;
+    uint32_t offset;
+    locate(id, FirstSegment, segment, offset);
+    string_view* views = segments[segment].load(memory_order_relaxed);
+    if (views == nullptr) {
+        views = new string_view[FirstSegment << segment];
+        segments[segment].store(views, memory_order_release);
+    }
+    views[offset] = strings.back();
+    count.store(id + 1, memory_order_release);
+    return id;
+}
+
+/**
+ * @brief Gives the string with the given id.
+ * @param id An id returned by intern.
+ * @return A view of the stored string.
+ */
+string_view StringPool::lookup(uint32_t id) const {
+    int segment;
+    uint32_t offset;
+    locate(id, FirstSegment, segment, offset);
+    return segments[segment].load(memory_order_acquire)[offset];
+}
+
+uint32_t StringPool::size() const {
+    return count.load(memory_order_acquire);
+}
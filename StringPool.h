@@ -0,0 +1,67 @@
+/**
+ * @file StringPool.h
+ * @brief Dictionary that stores each distinct string once and names it by a 32-bit id.
+ */
+
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+using namespace std;
+
+class StringPool {
+public:
+    /**
+     * @brief Constructor for the StringPool class.
+     * @post The pool holds only the empty string, whose id is 0.
+     */
+    StringPool();
+
+    ~StringPool();
+
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    /**
+     * @brief The pool shared by every ZipCode in the process.
+     */
+    static StringPool& shared();
+
+    /**
+     * @brief Gives the id of a string, adding it if it is new.
+     * @post lookup(id) returns text for the life of the pool.
+     */
+    uint32_t intern(string_view text);
+
+    /**
+     * @brief Gives the string with the given id.
+     * @pre id came from intern on this pool.
+     * @post The view stays valid for the life of the pool.
+     * @details Takes no lock: entries never move once added.
+     */
+    string_view lookup(uint32_t id) const;
+
+    /**
+     * @brief Gives the number of distinct strings in the pool.
+     */
+    uint32_t size() const;
+
+private:
+    // Segment k holds FirstSegment << k views, so no segment is ever moved or resized
+    static const uint32_t FirstSegment = 64;
+    static const int SegmentCount = 32;
+
+    mutable shared_mutex lock;                   // serializes intern; lookup does not take it
+    deque<string> strings;                       // deque keeps each string at a fixed address
+    unordered_map<string_view, uint32_t> ids;    // keys view the strings above
+    atomic<string_view*> segments[SegmentCount]; // views by id, read without the lock
+    atomic<uint32_t> count;                      // ids below count are published
+};
+
+#endif // STRINGPOOL_H
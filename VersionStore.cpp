@@ -0,0 +1,121 @@
+/**
+ * @file VersionStore.cpp
+ * @brief Implementation of the VersionStore class.
+ */
+
+#include "VersionStore.h"
+#include "BlockBuffer.h"
+#include <unistd.h>
+
+VersionStore::VersionStore() : epoch(0), versionCount(0) {}
+
+/**
+ * @brief Pins the current epoch.
+ * @return The pinned epoch.
+ */
+uint64_t VersionStore::pin() {
+    lock_guard<mutex> lock(guard);
+    pinned.insert(epoch);
+    return epoch;
+}
+
+/**
+ * @brief Releases a pinned epoch.
+ * @param epoch The epoch returned by pin.
+ */
+void VersionStore::unpin(uint64_t epoch) {
+    lock_guard<mutex> lock(guard);
+    auto found = pinned.find(epoch);
+    if (found != pinned.end())
+        pinned.erase(found);
+    reclaim();
+}
+
+/**
+ * @brief Saves a block's image before it is overwritten.
+ * @param fd The file the block is read from.
+ * @param rbn The block about to be written.
+ */
+void VersionStore::preserve(int fd, int rbn) {
+    lock_guard<mutex> lock(guard);
+    if (pinned.empty())
+        return;
+
+    // an image saved after the newest snapshot already covers every open snapshot
+    vector<Version>& saved = versions[rbn];
+    if (!saved.empty() && saved.back().epoch > *pinned.rbegin())
+        return;
+
+    string image(BUFSIZE, '\0');
+    ssize_t got = pread(fd, &image[0], BUFSIZE, static_cast<off_t>(rbn) * BUFSIZE);
+    if (got != BUFSIZE)
+        return;     // a block past the end of the file is new and no snapshot links to it
+    saved.push_back(Version{epoch + 1, move(image)});
+    versionCount++;
+}
+
+/**
+ * @brief Ends the current write operation.
+ */
+void VersionStore::commit() {
+    lock_guard<mutex> lock(guard);
+    epoch++;
+}
+
+/**
+ * @brief Looks up a block as it was at a pinned epoch.
+ * @param rbn The block to look up.
+ * @param epoch The snapshot's epoch.
+ * @param image Receives the saved image.
+ * @return True if an image was saved after the epoch.
+ */
+bool VersionStore::find(int rbn, uint64_t epoch, string& image) const {
+    lock_guard<mutex> lock(guard);
+    auto found = versions.find(rbn);
+    if (found == versions.end())
+        return false;
+    for (const Version& version : found->second) {
+        if (version.epoch > epoch) {
+            image = version.image;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Number of block images held.
+ */
+size_t VersionStore::getVersionCount() const {
+    lock_guard<mutex> lock(guard);
+    return versionCount;
+}
+
+// Frees the images no pinned epoch reads; the caller holds guard
+void VersionStore::reclaim() {
+    if (pinned.empty()) {
+        versions.clear();
+        versionCount = 0;
+        return;
+    }
+
+    for (auto entry = versions.begin(); entry != versions.end();) {
+        vector<Version>& saved = entry->second;
+        vector<Version> kept;
+        uint64_t previous = 0;
+        for (Version& version : saved) {
+            // snapshots pinned in [previous, version.epoch) read this image
+            auto reader = pinned.lower_bound(previous);
+            if (reader != pinned.end() && *reader < version.epoch)
+                kept.push_back(move(version));
+            previous = version.epoch;
+        }
+        versionCount -= saved.size() - kept.size();
+        if (kept.empty()) {
+            entry = versions.erase(entry);
+        } else {
+            saved.swap(kept);
+            ++entry;
+        }
+    }
+}
@@ -0,0 +1,85 @@
+/**
+ * @file VersionStore.h
+ * @brief Keeps the old images of blocks a writer overwrites while snapshots are open.
+ * @details Every write operation on a BFile is one epoch. A snapshot pins the epoch that
+ *          was current when it was taken. Before a writer overwrites a block that a pinned
+ *          snapshot may still need, it saves the block's image tagged with the epoch of
+ *          the operation doing the write. A snapshot reading a block uses the oldest image
+ *          saved after its epoch, or the block on disk if nothing was saved since.
+ *          When a snapshot is released, images no remaining snapshot can read are freed.
+ */
+
+#ifndef VERSIONSTORE_H
+#define VERSIONSTORE_H
+
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+class VersionStore {
+public:
+    VersionStore();
+
+    VersionStore(const VersionStore&) = delete;
+    VersionStore& operator=(const VersionStore&) = delete;
+
+    /**
+     * @brief Pins the current epoch for a snapshot.
+     * @pre No write operation is in progress, so the epoch describes a whole file.
+     * @return The pinned epoch, to be passed to find and unpin.
+     */
+    uint64_t pin();
+
+    /**
+     * @brief Releases a pinned epoch and frees the images no snapshot still needs.
+     */
+    void unpin(uint64_t epoch);
+
+    /**
+     * @brief Saves a block's image before it is overwritten, if a snapshot may need it.
+     * @param fd The file the block is read from.
+     * @param rbn The block about to be written.
+     * @pre The caller is the writer and holds the block's exclusive latch.
+     */
+    void preserve(int fd, int rbn);
+
+    /**
+     * @brief Ends the current write operation.
+     */
+    void commit();
+
+    /**
+     * @brief Looks up a block as it was at a pinned epoch.
+     * @param image Receives the block's saved image.
+     * @pre The caller holds the block's latch, at least shared.
+     * @return False if the block has not been overwritten since the epoch; the block on
+     *         disk is then the one the snapshot sees.
+     */
+    bool find(int rbn, uint64_t epoch, string& image) const;
+
+    /**
+     * @brief Number of block images held for open snapshots.
+     */
+    size_t getVersionCount() const;
+
+private:
+    // An image of a block, as it was before the write operation numbered epoch
+    struct Version {
+        uint64_t epoch;
+        string image;
+    };
+
+    void reclaim();
+
+    mutable mutex guard;
+    uint64_t epoch;                     // write operations committed so far
+    multiset<uint64_t> pinned;          // epochs of open snapshots
+    unordered_map<int, vector<Version>> versions;    // per RBN, oldest first
+    size_t versionCount;
+};
+
+#endif // VERSIONSTORE_H
@@ -0,0 +1,219 @@
+/**
+ * @file WriteOptimizedStore.cpp
+ * @brief Implementation of the WriteOptimizedStore class.
+ */
+
+#include "WriteOptimizedStore.h"
+#include <algorithm>
+
+// Orders a run's changes by zip code for lower_bound
+static bool zipBelow(const RecordChange& change, int zip) {
+    return change.zip < zip;
+}
+
+/**
+ * @brief Starts a store over a file.
+ * @param file The file changes are merged into.
+ * @param memtableLimit Changes buffered before the memtable is frozen.
+ */
+WriteOptimizedStore::WriteOptimizedStore(BFile& file, size_t memtableLimit)
+    : file(file), memtableLimit(memtableLimit > 0 ? memtableLimit : 1), runChanges(0),
+      runsFrozen(0), runsMerged(0), runsStarted(0), stopping(false) {
+    merger = thread(&WriteOptimizedStore::mergeLoop, this);
+}
+
+/**
+ * @brief Merges every buffered change and stops the merge thread.
+ */
+WriteOptimizedStore::~WriteOptimizedStore() {
+    drain();
+    {
+        lock_guard<mutex> lock(guard);
+        stopping = true;
+    }
+    changed.notify_all();
+    merger.join();
+}
+
+/**
+ * @brief Adds or replaces a record.
+ * @param record The new record.
+ */
+void WriteOptimizedStore::put(const ZipCode& record) {
+    change(RecordChange{record.getNum(), false, record});
+}
+
+/**
+ * @brief Deletes a zip code.
+ * @param zip The zip code to delete.
+ */
+void WriteOptimizedStore::remove(int zip) {
+    change(RecordChange{zip, true, ZipCode()});
+}
+
+// Buffers one change; the newest change to a zip code replaces older ones in the memtable
+void WriteOptimizedStore::change(const RecordChange& change) {
+    unique_lock<mutex> lock(guard);
+    // writers wait for the merge only when it has fallen MaxRuns runs behind
+    changed.wait(lock, [this] { return runs.size() < MaxRuns; });
+    memtable[change.zip] = change;
+    if (memtable.size() >= memtableLimit)
+        freezeLocked();
+}
+
+// Turns the memtable into the newest run; the caller holds guard
+void WriteOptimizedStore::freezeLocked() {
+    if (memtable.empty())
+        return;
+    Run run;
+    run.reserve(memtable.size());
+    for (auto& entry : memtable)
+        run.push_back(entry.second);
+    memtable.clear();
+    runChanges += run.size();
+    runs.push_back(make_shared<const Run>(move(run)));
+    runsFrozen++;
+    changed.notify_all();
+}
+
+/**
+ * @brief Finds a record, including unmerged changes.
+ * @param zip The zip code to look for.
+ * @param result Receives a copy of the record.
+ * @return True if the zip code is present.
+ */
+bool WriteOptimizedStore::findRecord(int zip, ZipCode& result) {
+    {
+        lock_guard<mutex> lock(guard);
+        const RecordChange* latest = nullptr;
+        auto buffered = memtable.find(zip);
+        if (buffered != memtable.end())
+            latest = &buffered->second;
+        for (auto run = runs.rbegin(); latest == nullptr && run != runs.rend(); ++run) {
+            auto found = lower_bound((*run)->begin(), (*run)->end(), zip, zipBelow);
+            if (found != (*run)->end() && found->zip == zip)
+                latest = &*found;
+        }
+        if (latest != nullptr) {
+            if (latest->remove)
+                return false;
+            result = latest->record;
+            return true;
+        }
+    }
+    // a run merged after the check above held nothing for this zip code
+    return file.findRecord(zip, result);
+}
+
+/**
+ * @brief Finds every record in a range of zip codes.
+ * @param low The lowest zip code wanted.
+ * @param high The highest zip code wanted.
+ * @param result Receives copies of the records, in zip order.
+ * @return The number of records found.
+ */
+int WriteOptimizedStore::findRange(int low, int high, vector<ZipCode>& result) {
+    vector<shared_ptr<const Run>> pending;
+    Run buffered;
+    vector<ZipCode> stored;
+    for (;;) {
+        uint64_t covered;
+        {
+            lock_guard<mutex> lock(guard);
+            pending.assign(runs.begin(), runs.end());
+            buffered.clear();
+            for (auto entry = memtable.lower_bound(low); entry != memtable.end() && entry->first <= high; ++entry)
+                buffered.push_back(entry->second);
+            covered = runsFrozen;
+        }
+
+        stored.clear();
+        file.findRange(low, high, stored);
+
+        // the file may hold runs from the snapshot, which are overlaid again below and so
+        // change nothing; a run frozen after it may hold newer changes the older ones
+        // would overwrite, so once the merge thread has started one the file is read again
+        lock_guard<mutex> lock(guard);
+        if (runsStarted <= covered)
+            break;
+    }
+    map<int, ZipCode> records;
+    for (ZipCode& record : stored)
+        records.emplace(record.getNum(), record);
+
+    auto overlay = [&records, low, high](const Run& run) {
+        for (auto change = lower_bound(run.begin(), run.end(), low, zipBelow);
+             change != run.end() && change->zip <= high; ++change) {
+            if (change->remove)
+                records.erase(change->zip);
+            else
+                records[change->zip] = change->record;
+        }
+    };
+    for (const shared_ptr<const Run>& run : pending)
+        overlay(*run);
+    overlay(buffered);
+
+    for (auto& entry : records)
+        result.push_back(entry.second);
+    return records.size();
+}
+
+/**
+ * @brief Merges every change made so far into the file.
+ */
+void WriteOptimizedStore::drain() {
+    unique_lock<mutex> lock(guard);
+    freezeLocked();
+    uint64_t target = runsFrozen;
+    changed.wait(lock, [this, target] { return runsMerged >= target; });
+}
+
+/**
+ * @brief Number of unmerged changes.
+ */
+size_t WriteOptimizedStore::getBufferedCount() const {
+    lock_guard<mutex> lock(guard);
+    return memtable.size() + runChanges;
+}
+
+/**
+ * @brief Number of runs waiting to be merged.
+ */
+size_t WriteOptimizedStore::getRunCount() const {
+    lock_guard<mutex> lock(guard);
+    return runs.size();
+}
+
+// Merges the runs waiting when it wakes into the file, oldest first
+void WriteOptimizedStore::mergeLoop() {
+    unique_lock<mutex> lock(guard);
+    for (;;) {
+        changed.wait(lock, [this] { return stopping || !runs.empty(); });
+        if (runs.empty())
+            return;
+
+        vector<shared_ptr<const Run>> batch(runs.begin(), runs.end());
+        runsStarted = runsMerged + batch.size();
+        lock.unlock();
+
+        // the newest change to each zip code wins; the batch stays sorted
+        map<int, const RecordChange*> newest;
+        for (const shared_ptr<const Run>& run : batch)
+            for (const RecordChange& change : *run)
+                newest[change.zip] = &change;
+        Run merged;
+        merged.reserve(newest.size());
+        for (auto& entry : newest)
+            merged.push_back(*entry.second);
+        file.applyChanges(merged);
+
+        lock.lock();
+        for (const shared_ptr<const Run>& run : batch)
+            runChanges -= run->size();
+        // runs stay readable until the file holds them
+        runs.erase(runs.begin(), runs.begin() + batch.size());
+        runsMerged += batch.size();
+        changed.notify_all();
+    }
+}
@@ -0,0 +1,107 @@
+/**
+ * @file WriteOptimizedStore.h
+ * @brief Write path that buffers changes in memory and merges them into a BFile in batches.
+ * @details Adds and deletes go into a sorted memtable, which costs a map insert instead
+ *          of a block read-modify-write. A full memtable is frozen into an immutable
+ *          sorted run, and a background thread merges the oldest runs into the BFile with
+ *          BFile::applyChanges, which rewrites each block it touches once, in list order.
+ *          Lookups consult the memtable, then the runs from newest to oldest, then the
+ *          file, so a change is visible as soon as put or remove returns.
+ *          Runs live in memory; a change is on disk once drain returns.
+ */
+
+#ifndef WRITEOPTIMIZEDSTORE_H
+#define WRITEOPTIMIZEDSTORE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "BFile.h"
+using namespace std;
+
+class WriteOptimizedStore {
+public:
+    static const size_t DefaultMemtableLimit = 4096;
+    static const size_t MaxRuns = 8;
+
+    /**
+     * @brief Starts a store over a file.
+     * @param file The file changes are merged into; it must outlive the store.
+     * @param memtableLimit Changes buffered before the memtable is frozen into a run.
+     */
+    explicit WriteOptimizedStore(BFile& file, size_t memtableLimit = DefaultMemtableLimit);
+
+    /**
+     * @brief Merges every buffered change into the file and stops the merge thread.
+     */
+    ~WriteOptimizedStore();
+
+    WriteOptimizedStore(const WriteOptimizedStore&) = delete;
+    WriteOptimizedStore& operator=(const WriteOptimizedStore&) = delete;
+
+    /**
+     * @brief Adds a record, replacing any record with the same zip code.
+     * @post Waits only while MaxRuns runs are already waiting to be merged.
+     */
+    void put(const ZipCode& record);
+
+    /**
+     * @brief Deletes a zip code; deleting one that is not there changes nothing.
+     */
+    void remove(int zip);
+
+    /**
+     * @brief Finds a record, including changes that are not merged yet.
+     * @return True if the zip code is present.
+     */
+    bool findRecord(int zip, ZipCode& result);
+
+    /**
+     * @brief Finds every record whose zip code is between low and high, inclusive.
+     * @param result Receives copies of the records, in zip order.
+     * @return The number of records found.
+     */
+    int findRange(int low, int high, vector<ZipCode>& result);
+
+    /**
+     * @brief Merges every change made so far into the file.
+     * @post The file holds every change whose put or remove returned before the call.
+     */
+    void drain();
+
+    /**
+     * @brief Number of changes in the memtable and the runs.
+     */
+    size_t getBufferedCount() const;
+
+    /**
+     * @brief Number of runs waiting to be merged.
+     */
+    size_t getRunCount() const;
+
+private:
+    typedef vector<RecordChange> Run;   // sorted by zip, one change per zip code
+
+    void change(const RecordChange& change);
+    void freezeLocked();
+    void mergeLoop();
+
+    BFile& file;
+    size_t memtableLimit;
+    mutable mutex guard;
+    condition_variable changed;         // signals the merge thread and waiting writers
+    map<int, RecordChange> memtable;
+    deque<shared_ptr<const Run>> runs;  // oldest first; the front ones may be merging
+    size_t runChanges;                  // changes held in runs
+    uint64_t runsFrozen, runsMerged;    // runs made and merged so far, for drain
+    uint64_t runsStarted;               // runs the merge thread has begun writing, for findRange
+    bool stopping;
+    thread merger;
+};
+
+#endif // WRITEOPTIMIZEDSTORE_H
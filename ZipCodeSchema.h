@@ -0,0 +1,100 @@
+/**
+ * @file ZipCodeSchema.h
+ * @brief Compile-time description of the six ZipCode fields for RecordCodec.
+ * @details Each field I has a ZipCodeField<I> with three members:
+ *          length(record) gives the encoded text length, append(out, record) writes the
+ *          text, and set(record, text, length) parses the text into the record. Every
+ *          member works on both ZipCode and ZipCodeView.
+ */
+
+#ifndef ZIPCODESCHEMA_H
+#define ZIPCODESCHEMA_H
+
+#include <string>
+#include "zipCode.h"
+#include "ZipCodeView.h"
+#include "NumberCodec.h"
+using namespace std;
+
+template <int I>
+struct ZipCodeField;
+
+// Zip code number
+template <>
+struct ZipCodeField<0> {
+    template <class R> static int length(const R& z) { return NumberCodec::intLength(z.getNum()); }
+    template <class R> static void append(string& out, const R& z) { NumberCodec::appendInt(out, z.getNum()); }
+    static void set(ZipCode& z, const char* text, int length) { z.setNum(NumberCodec::toInt(text, length)); }
+    static void set(ZipCodeView& z, const char* text, int length) { z.setNum(NumberCodec::toInt(text, length)); }
+};
+
+// Place name
+template <>
+struct ZipCodeField<1> {
+    template <class R> static int length(const R& z) { return z.getCity().size(); }
+    template <class R> static void append(string& out, const R& z) { out.append(z.getCity()); }
+    static void set(ZipCode& z, const char* text, int length) { z.setCity(string_view(text, length)); }
+    static void set(ZipCodeView& z, const char* text, int length) { z.setCity(string_view(text, length)); }
+};
+
+// State code
+template <>
+struct ZipCodeField<2> {
+    template <class R> static int length(const R& z) { return z.getStateCode().size(); }
+    template <class R> static void append(string& out, const R& z) { out.append(z.getStateCode()); }
+    static void set(ZipCode& z, const char* text, int length) { z.setStateCode(string_view(text, length)); }
+    static void set(ZipCodeView& z, const char* text, int length) { z.setStateCode(string_view(text, length)); }
+};
+
+// County
+template <>
+struct ZipCodeField<3> {
+    template <class R> static int length(const R& z) { return z.getCounty().size(); }
+    template <class R> static void append(string& out, const R& z) { out.append(z.getCounty()); }
+    static void set(ZipCode& z, const char* text, int length) { z.setCounty(string_view(text, length)); }
+    static void set(ZipCodeView& z, const char* text, int length) { z.setCounty(string_view(text, length)); }
+};
+
+// Latitude, held in micro-degrees and written as a six-place decimal
+template <>
+struct ZipCodeField<4> {
+    template <class R> static int length(const R& z) { return NumberCodec::fixed6Length(z.getLatMicro()); }
+    template <class R> static void append(string& out, const R& z) { NumberCodec::appendFixed6(out, z.getLatMicro()); }
+    static void set(ZipCode& z, const char* text, int length) { z.setLatMicro(NumberCodec::toFixed6(text, length)); }
+    static void set(ZipCodeView& z, const char* text, int length) { z.setLatMicro(NumberCodec::toFixed6(text, length)); }
+};
+
+// Longitude, held in micro-degrees and written as a six-place decimal
+template <>
+struct ZipCodeField<5> {
+    template <class R> static int length(const R& z) { return NumberCodec::fixed6Length(z.getLonMicro()); }
+    template <class R> static void append(string& out, const R& z) { NumberCodec::appendFixed6(out, z.getLonMicro()); }
+    static void set(ZipCode& z, const char* text, int length) { z.setLonMicro(NumberCodec::toFixed6(text, length)); }
+    static void set(ZipCodeView& z, const char* text, int length) { z.setLonMicro(NumberCodec::toFixed6(text, length)); }
+};
+
+/**
+ * @brief Schema of a ZipCode record: its fields in on-disk order.
+ */
+struct ZipCodeSchema {
+    typedef ZipCode Record;
+
+    static const int FieldCount = 6;
+
+    template <int I>
+    using Field = ZipCodeField<I>;
+};
+
+/**
+ * @brief Schema of a ZipCodeView: the same fields, decoded without copying text.
+ */
+struct ZipCodeViewSchema {
+    typedef ZipCodeView Record;
+
+    static const int FieldCount = 6;
+
+    template <int I>
+    using Field = ZipCodeField<I>;
+};
+
+#endif // ZIPCODESCHEMA_H
@@ -0,0 +1,63 @@
+/**
+ * @file ZipCodeView.h
+ * @brief Read-only zip code record whose text fields point into a block or file buffer.
+ */
+
+#ifndef ZIPCODEVIEW_H
+#define ZIPCODEVIEW_H
+
+#include <string>
+#include <string_view>
+#include "zipCode.h"
+using namespace std;
+
+class ZipCodeView {
+public:
+    /**
+     * @brief Default constructor.
+     * @post The view is empty and its number is -1, as for ZipCode.
+     */
+    ZipCodeView() : num(-1), latMicro(0), lonMicro(0) {}
+
+    /**
+     * @brief Makes a view of an owning record.
+     * @pre zip outlives the view.
+     */
+    explicit ZipCodeView(const ZipCode& zip)
+        : num(zip.getNum()), latMicro(zip.getLatMicro()), lonMicro(zip.getLonMicro()),
+          city(zip.getCity()), stateCode(zip.getStateCode()), county(zip.getCounty()) {}
+
+    // Setters and Getters
+    // @brief The text fields are only valid while the buffer they point into is unchanged.
+    void setNum(int newNum) { num = newNum; }
+    int getNum() const { return num; }
+    void setCity(string_view newCity) { city = newCity; }
+    string_view getCity() const { return city; }
+    void setStateCode(string_view newStateCode) { stateCode = newStateCode; }
+    string_view getStateCode() const { return stateCode; }
+    void setCounty(string_view newCounty) { county = newCounty; }
+    string_view getCounty() const { return county; }
+    float getLat() const { return latMicro / float(NumberCodec::Fixed6Scale); }
+    float getLon() const { return lonMicro / float(NumberCodec::Fixed6Scale); }
+    void setLatMicro(int newLat) { latMicro = newLat; }
+    int getLatMicro() const { return latMicro; }
+    void setLonMicro(int newLon) { lonMicro = newLon; }
+    int getLonMicro() const { return lonMicro; }
+
+    /**
+     * @brief Copies the view into an owning ZipCode, for callers that keep or mutate it.
+     */
+    ZipCode toZipCode() const {
+        return ZipCode::fromMicroDegrees(num, city, stateCode, county, latMicro, lonMicro);
+    }
+
+private:
+    int num;
+    int latMicro;
+    int lonMicro;
+    string_view city;
+    string_view stateCode;
+    string_view county;
+};
+
+#endif // ZIPCODEVIEW_H
@@ -3,6 +3,8 @@
 * Member function definitions for the delimBuffer class.  
 */
 #include "delimBuffer.h"
+#include "RecordCodec.h"
+#include "FieldScanner.h"
 #include <iostream>
 #include <string> 
 
@@ -23,7 +25,9 @@ delimBuffer::delimBuffer() {
 @param1 delim a character which is a comma.  
 @param2 maxsize an int which is the maxsizef the buffer.
 */
-delimBuffer::delimBuffer(char delim = ',', int maxsize = 1000) {
+delimBuffer::delimBuffer(char delim, int maxsize) {
+	this->delim = delim;
+	max = maxsize;
 	index = 0;
 	buffer = "";
 	size = 0;
@@ -48,17 +52,50 @@ bool delimBuffer::read(ifstream& inFile) {
 
 }
 
+/*
+@brief Reads the header lines of a csv file.
+@pre inFile is at the start of the file.
+@param1 inFile an ifstream variable which contains the csv file.
+@param2 headerData a string which receives the lowercased header.
+*/
+bool delimBuffer::readHeader(ifstream& inFile, string& headerData) {
+	// quoted column names may span lines, so read until every quote is closed
+	int quotes = 0;
+	headerData.clear();
+	do {
+		if (!read(inFile))
+			return false;
+		for (int i = FieldScanner::findChar(buffer.data(), 0, size, '"'); i < size;
+			 i = FieldScanner::findChar(buffer.data(), i + 1, size, '"')) {
+			quotes++;
+		}
+		headerData.append(buffer);
+	} while (quotes % 2 != 0);
 
-bool delimBuffer::unpack(string& field) {
-	if (index != size && size != 0) { // execute only when delimBuffer is not empty
+	for (size_t i = 0; i < headerData.size(); i++) {
+		headerData[i] = tolower(headerData[i]);
+	}
+	return true;
+}
 
-		while (index < size && buffer[index] != delim) { // 
-			field.push_back(buffer[index++]);
-		}
-		if (buffer[index] == delim)
-			index++;
+/*
+@brief Appends the next field of the line to field.
+@pre read or setBuffer has loaded a line.
+@param1 field a string which receives the characters of the field.
+*/
+bool delimBuffer::unpack(string& field) {
+	int start, length;
+	if (index < size && CsvCodec::nextField(buffer.data(), size, index, start, length, delim)) { // execute only when fields remain on the line
+		field.append(buffer, start, length);
 		return true;
-
 	}
 	return false;
 }
+
+/*
+@brief Parses the line into a ZipCode.
+@param1 zip a ZipCode which receives the fields.
+*/
+bool delimBuffer::unpack(ZipCode& zip) {
+	return size != 0 && CsvCodec::decodeBody(buffer.data(), size, zip);
+}
@@ -10,6 +10,7 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include "zipCode.h"
 using namespace std;
 
 /**
@@ -42,20 +43,33 @@ public:
 	*/
 	bool unpack(string & field);
 
+	/**
+	@brief Parses the whole line as a record with the fields in ZipCode order
+	@pre delimBuffer must not be empty
+	@post Returns true if every field was present
+	*/
+	bool unpack(ZipCode & zip);
+
 	/**
 	@brief reads from csv file and places on string
 	@post returns the string of one line of us_postal_codes.csv 
 	*/
 	bool read(ifstream& inFile);
 
+	/**
+	@brief Reads the header of a csv file, which may span lines inside quoted names
+	@post headerData holds the lowercased header; returns false if the file ended first
+	*/
+	bool readHeader(ifstream& inFile, string& headerData);
+
 	/**
 	@brief Gives the delimBuffer string  
 	@post Returns the delimBuffer string  
 	*/
 	void setBuffer(string x) { 
-		buffer = x; };
+		buffer = x; size = buffer.size(); index = 0; };
 
-	string getBuffer() { 
+	const string& getBuffer() const { 
 		return buffer; };
 
 };
@@ -5,7 +5,7 @@
  * This file contains the main function and helper functions for managing 
  * a postal code database. It handles CSV file processing, record addition and deletion, 
  * database searching, and displaying specific records. It uses various classes like 
- * PrimaryIndex, LengthBuffer, ZipCode, BFile, Buffer_Record, and CSVReader to perform its operations.
+ * PrimaryIndex, LengthBuffer, ZipCode, BFile, Buffer_Record, and AnalysisCache to perform its operations.
  * 
  * @author Group 7
  */
@@ -15,10 +15,21 @@
 #include "PrimaryIndex.h"
 #include "delimBuffer.h"
 #include "LengthBuffer.h"
-#include "ZipCode.h"
+#include "zipCode.h"
 #include "BFile.h"
+#include "BlockVerifier.h"
+#include "DatabaseImage.h"
+#include "SharedIndex.h"
 #include "Buffer_Record.h"
-#include "CSVReader.h"
+#include "NumberCodec.h"
+#include "AnalysisCache.h"
+#include "QueryServer.h"
+#include "RowParser.h"
+#include "WriteOptimizedStore.h"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <csignal>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -26,12 +37,19 @@
 using namespace std;
 
 // Declarations for helper functions
-void analyzeCSV(CSVReader &csvReader);
-void addRecord(BFile& bf);
-void delRecord(BFile& bf, const string& arg);
-void handleFileImport(const string& filename);
-void searchDatabase(const PrimaryIndex& indexList);
-void displayRecordFromOffset(ifstream& FS, unsigned long offset);
+bool analyzeCSV(const string& csvFile, bool forceAnalysis);
+int addRecord(BFile& bf);
+int delRecord(BFile& bf, const string& arg);
+int updateRecord(BFile& bf, const string& arg);
+int handleFileImport(const string& filename);
+void searchDatabase(PrimaryIndex& indexList);
+void displayRecordFromOffset(fstream& FS, unsigned long offset);
+void displayRecord(const ZipCodeView& record);
+int serve(BFile& bf, const string& socketPath, int threads);
+int ingestCSV(BFile& bf, const string& csvFile);
+int retireZips(BFile& bf, const string& zipFile);
+int applyChangeFile(BFile& bf, const string& changeFile);
+int reimportCSV(BFile& bf, const string& csvFile);
 
 /**
  * @brief Main function to process user commands and manage the postal code database.
@@ -45,12 +63,6 @@ void displayRecordFromOffset(ifstream& FS, unsigned long offset);
  */
 // main to process user commands and manage the postal code database.
 int main(int argc, char* argv[]) {
-    // Process CSV file at the beginning
-    std::string csvFile = "us_postal_codes.csv";
-    std::cout << "Processing us_postal_codes.csv.\n" << std::endl;
-    CSVReader csvReader(csvFile);
-    analyzeCSV(csvReader);
-
     // Process command-line arguments
     if (argc < 2) {
         cout << "Usage: " << argv[0] << " -option [additional arguments]" << endl;
@@ -58,22 +70,115 @@ int main(int argc, char* argv[]) {
     }
     
     string option = argv[1];
-    bFile bf;
+
+    if (option == "-stats" || option == "-analyze") {
+        // -stats serves the cached report, -analyze re-parses the CSV
+        return analyzeCSV(argc == 3 ? argv[2] : "us_postal_codes.csv", option == "-analyze") ? 0 : 1;
+    }
+
+    if (option == "-verify") {
+        // checks an existing file without rebuilding it, against the index its blocks give
+        string fileName = argc == 3 ? argv[2] : "DataFile.txt";
+        if (!ifstream(fileName).is_open()) {
+            cout << "Cannot open " << fileName << endl;
+            return 1;
+        }
+        BFile file(fileName);
+        VerifyReport report = file.verify();
+        for (const string& problem : report.problems)
+            cout << problem << '\n';
+        cout << report.blocksChecked << " blocks, " << report.activeBlocks << " active, "
+             << report.records << " records, " << report.checksummedBlocks << " checksummed, "
+             << report.problemCount << " problems" << endl;
+        return report.ok() ? 0 : 2;
+    }
+
+    if (option == "-zi" && argc >= 3) {
+        // answers from a snapshot image without building any index
+        DatabaseImage image;
+        if (!image.open(argc == 4 ? argv[3] : "Database.image")) {
+            cout << "Cannot open the database image" << endl;
+            return 1;
+        }
+        int position = image.find(stoi(argv[2]));
+        if (position < 0) {
+            cout << "cant find zip" << endl;
+            return 1;
+        }
+        ZipCodeView record;
+        image.getRecord(position, record);
+        displayRecord(record);
+        return 0;
+    }
+
+    if (option == "-publish") {
+        // copies a snapshot image into shared memory for -z to attach to
+        string image = argc >= 3 ? argv[2] : "Database.image";
+        if (!SharedIndex::publishFile(argc == 4 ? argv[3] : "zipcode", image)) {
+            cout << "Cannot publish " << image << endl;
+            return 1;
+        }
+        cout << "Published " << image << endl;
+        return 0;
+    }
+
+    if (option == "-z" && argc == 3) {
+        // every process attaches to the same published index instead of loading its own,
+        // unless the files have changed since its image was built
+        SharedIndex shared;
+        if (shared.attach("zipcode")
+            && shared.getImage().getSourceStamp() == DatabaseImage::sourceStamp("IndexFile.index", "data.txt")) {
+            const DatabaseImage& image = shared.getImage();
+            int position = image.find(stoi(argv[2]));
+            if (position < 0) {
+                cout << "cant find zip" << endl;
+                return 1;
+            }
+            ZipCodeView record;
+            image.getRecord(position, record);
+            displayRecord(record);
+            return 0;
+        }
+    }
+
+    BFile bf;
 
     if (option == "-pd") {
-        cout << bf.physicalDump();  // Updated method name
+        bf.physicalDump(cout);  // Streams block by block
     } else if (option == "-ld") {
-        cout << bf.logicalDump();  // Updated method name
+        bf.logicalDump(cout);
     } else if (option == "-a") {
-        addRecord(bf);  // Updated function call
+        return addRecord(bf);
     } else if (option == "-d" && argc == 3) {
-        delRecord(bf, argv[2]);  // Updated function call
+        return delRecord(bf, argv[2]);
+    } else if (option == "-u" && argc == 3) {
+        return updateRecord(bf, argv[2]);
+    } else if (option == "-snapshot") {
+        string image = argc == 3 ? argv[2] : "Database.image";
+        if (DatabaseImage::build(image, "IndexFile.index", "data.txt", &bf.getBlockIndex()))
+            cout << "Snapshot written to " << image << endl;
+        else
+            cout << "Snapshot failed" << endl;
+    } else if (option == "-ingest" && argc == 3) {
+        return ingestCSV(bf, argv[2]);
+    } else if (option == "-retire" && argc == 3) {
+        return retireZips(bf, argv[2]);
+    } else if (option == "-apply" && argc == 3) {
+        return applyChangeFile(bf, argv[2]);
+    } else if (option == "-reimport" && argc == 3) {
+        return reimportCSV(bf, argv[2]);
+    } else if (option == "-serve") {
+        return serve(bf, argc >= 3 ? argv[2] : "zipcode.sock", argc == 4 ? stoi(argv[3]) : 0);
     } else if (option == "-r" && argc == 3) {
-        handleFileImport(argv[2]);  // Unchanged
+        return handleFileImport(argv[2]);
     } else if (option == "-z" && argc == 3) {
-        PrimaryIndex indexList("primIndex.index", "data.txt);
-        ifstream FS("data.txt");
+        PrimaryIndex indexList("IndexFile.index", "data.txt");
+        fstream FS("data.txt");
         unsigned long offset = indexList.search(stoi(argv[2]));
+        if (offset == 0) {
+            cout << "cant find zip" << endl;     // never added, or deleted
+            return 1;
+        }
         displayRecordFromOffset(FS, offset);
     } else {
         cout << "Invalid arguments" << endl;
@@ -86,14 +191,16 @@ int main(int argc, char* argv[]) {
  * @brief Adds a new record to the  database.
  * 
  * Prompts the user to enter details for a new postal code record and adds it to the database.
+ * The record is also appended to the data file and the primary index, which the block
+ * file is rebuilt from on the next start.
  * 
  * @param bf Reference to BFile object representing the database file.
+ * @return int Exit status of the command.
  */
 //add record 
-void addRecord(BFile& b) {
+int addRecord(BFile& b) {
     ZipCode address;  // Correct class name
     string temporary;
-    float lat, lon;
     int zip;
 
     cout << "Zip Code: ";
@@ -114,41 +221,144 @@ void addRecord(BFile& b) {
     address.setCounty(temporary);
 
     cout << "Latitude: ";
-    cin >> lat;  // Directly read as float
-    address.setLat(lat);
+    cin >> temporary;  // Read as text so the micro-degrees are exact
+    address.setLatMicro(NumberCodec::toFixed6(temporary.data(), temporary.size()));
 
     cout << "Longitude: ";
-    cin >> lon;  // Directly read as float
-    address.setLon(lon);
+    cin >> temporary;
+    address.setLonMicro(NumberCodec::toFixed6(temporary.data(), temporary.size()));
 
-    if (b.addRecord(address))  // Correct object name
-        cout << "Record added\n";
-    else
+    if (!PrimaryIndex::fits(address)) {
+        cout << "Record not added: it is too long for the data file\n";
+        return 1;
+    }
+    if (!b.addRecord(address)) {
         cout << "Record not added\n";
+        return 1;
+    }
+    b.flush();
+
+    PrimaryIndex indexList("IndexFile.index", "data.txt");
+    if (!indexList.append({address})) {
+        cerr << "Cannot append the added record to data.txt" << endl;
+        return 1;
+    }
+    indexList.writeToFile();
+
+    cout << "Record added\n";
+    return 0;
+}
+
+/**
+ * @brief Changes the fields of an existing record.
+ * 
+ * Prompts for each field with its current value; entering "-" keeps the value.
+ * The record is rewritten inside its block, and the new version is appended to the data
+ * file and the primary index, which the block file is rebuilt from on the next start.
+ * 
+ * @param bf Reference to BFile object representing the database file.
+ * @param arg String representing the zip code of the record to be updated.
+ * @return int Exit status of the command.
+ */
+int updateRecord(BFile& b, const string& arg) {
+    ZipCode address;
+    string temporary;
+
+    if (!b.findRecord(stoi(arg), address)) {
+        cout << "Record not found\n";
+        return 1;
+    }
+
+    cout << "City [" << address.getCity() << "]: ";
+    cin >> temporary;
+    if (temporary != "-") address.setCity(temporary);
+
+    cout << "State Code [" << address.getStateCode() << "]: ";
+    cin >> temporary;
+    if (temporary != "-") address.setStateCode(temporary);
+
+    cout << "County [" << address.getCounty() << "]: ";
+    cin >> temporary;
+    if (temporary != "-") address.setCounty(temporary);
+
+    cout << "Latitude [" << address.getLat() << "]: ";
+    cin >> temporary;
+    if (temporary != "-") address.setLatMicro(NumberCodec::toFixed6(temporary.data(), temporary.size()));
+
+    cout << "Longitude [" << address.getLon() << "]: ";
+    cin >> temporary;
+    if (temporary != "-") address.setLonMicro(NumberCodec::toFixed6(temporary.data(), temporary.size()));
+
+    if (!PrimaryIndex::fits(address)) {
+        cout << "Record not updated: it is too long for the data file\n";
+        return 1;
+    }
+    if (!b.updateRecord(address)) {
+        cout << "Record not updated\n";
+        return 1;
+    }
+    b.flush();
+
+    // the index entry moves to the appended copy, and the old one is left for compact
+    PrimaryIndex indexList("IndexFile.index", "data.txt");
+    if (!indexList.append({address})) {
+        cerr << "Cannot append the updated record to data.txt" << endl;
+        return 1;
+    }
+    if (!indexList.compact())
+        indexList.writeToFile();
+
+    cout << "Record updated\n";
+    return 0;
 }
 
 /**
  * @brief Deletes a record from the database based on the provided address
  * 
+ * The primary index marks the zip code deleted as well, as the block file is rebuilt
+ * from it on the next start.
+ * 
  * @param bf Reference to BFile object representing the database file.
  * @param arg String representing the zip code of the record to be deleted.
+ * @return int Exit status of the command.
  */
 
-void delRecord(blockFile& b, const string& arg) {
-    if (b.delRecord(arg))
-		cout << "Record deleted \n";
-	else
-		cout << "Failed to delete \n";
+int delRecord(BFile& b, const string& arg) {
+    if (!b.deleteRecord(arg)) {
+        cout << "Failed to delete \n";
+        return 1;
+    }
+    b.flush();
+
+    PrimaryIndex indexList("IndexFile.index", "data.txt");
+    indexList.remove(stoi(arg));
+    if (!indexList.compact())
+        indexList.writeToFile();
+
+    cout << "Record deleted \n";
+    return 0;
 }
 
 /**
  * @brief Handles importing of a file into the postal code database.
  * 
+ * The data file and the index are left alone if the file cannot be opened or its
+ * header does not name every zip code field.
+ * 
  * @param filename String representing the name of the file to be imported.
+ * @return int Exit status of the command.
  */
-void handleFileImport(const string& filename) {
+int handleFileImport(const string& filename) {
     ifstream inFile(filename);
-    primaryIndex indexList(inFile);
+    if (!inFile.is_open()) {
+        cerr << "Cannot open " << filename << endl;
+        return 1;
+    }
+    PrimaryIndex indexList(inFile);
+    if (indexList.getSize() == 0) {
+        cerr << "Nothing imported from " << filename << endl;
+        return 1;
+    }
     cout << "File imported successfully" << endl;
     cout << "Do you want to search the database? (Y/N): ";
     char response;
@@ -156,6 +366,7 @@ void handleFileImport(const string& filename) {
     if (tolower(response) == 'y') {
         searchDatabase(indexList);
     }
+    return 0;
 }
 
 /**
@@ -164,29 +375,29 @@ void handleFileImport(const string& filename) {
  * @param indexList Reference to PrimaryIndex object for searching the database.
  */
 //Searches the database for a specific address and displays
-void searchDatabase(const PrimaryIndex& indexList) {
+void searchDatabase(PrimaryIndex& indexList) {
     int valid_zip;
     cout << "Please enter a valid zip: ";
     cin >> valid_zip;
-    unsigned long offset = indexList.search(valid_zip;);
+    unsigned long offset = indexList.search(valid_zip);
     if (offset == 0) {
         cout << "cant find zip" << endl;
         return;
     }
-    ifstream dFile("data.txt");
-    displayRecordFromOffset(FS, offset);
+    fstream dFile("data.txt");
+    displayRecordFromOffset(dFile, offset);
 }
 
 /**
  * @brief Displays a record from the database at a specific offset.
  * 
- * @param FS Reference to ifstream object to read data from the database file.
+ * @param FS Reference to fstream object to read data from the database file.
  * @param offset Unsigned long representing the offset in the file where the record is located.
  */
 //display @offset
-void displayRecordFromOffset(ifstream& FS, unsigned long offset) {
+void displayRecordFromOffset(fstream& FS, unsigned long offset) {
     LengthBuffer showing_addr;
-    indicated.read(FS, offset);
+    showing_addr.read(FS, offset);
     for (int i = 0; i < 6; ++i) {
         string temp;
         showing_addr.unpack(temp);
@@ -194,22 +405,403 @@ void displayRecordFromOffset(ifstream& FS, unsigned long offset) {
     }
 }
 /**
- * @brief Analyzes and displays state statistics from a CSVReader object.
- * @param csvReader The CSVReader object to analyze.
- * @pre The CSVReader object is open and initialized.
- * @post State statistics are displayed for the given CSVReader object.
+ * @brief Displays a record found in an index image.
+ * @param record The record to display.
  */
-//Analyzes and displays state statistics from a CSVReader object.
-void analyzeCSV(CSVReader &csvReader) {
-    //CSVReader csvReader(fileName);
-    if (!csvReader.isOpen()) {
-        std::cerr << "Failed to open CSV file." << std::endl;
-        return;
+//display a record
+void displayRecord(const ZipCodeView& record) {
+    cout << "Zip Code: " << record.getNum() << "\nPlace Name: " << record.getCity()
+         << "\nState: " << record.getStateCode() << "\nCounty: " << record.getCounty()
+         << "\nLat: " << record.getLat() << "\nLong: " << record.getLon() << endl;
+}
+
+// Server stopped by SIGINT and SIGTERM
+static QueryServer* activeServer = nullptr;
+
+static void stopServer(int) {
+    if (activeServer != nullptr)
+        activeServer->requestShutdown();
+}
+
+/**
+ * @brief Serves the database over a Unix domain socket until stopped.
+ * @param bf Reference to BFile object representing the database file.
+ * @param socketPath Path of the socket to listen on.
+ * @param threads Connections served at once, or 0 for one per hardware thread.
+ * @return Exit status of the program.
+ */
+//serve the database until SHUTDOWN or a signal
+int serve(BFile& bf, const string& socketPath, int threads) {
+    QueryServer server(bf, socketPath, threads);
+    if (!server.start()) {
+        cerr << "Cannot listen on " << socketPath << endl;
+        return 1;
     }
-    // Read and process the CSV file.
-    csvReader.ReadFile();
+    activeServer = &server;
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+
+    cout << "Serving on " << socketPath << endl;
+    server.run();
 
+    activeServer = nullptr;
+    cout << "Server stopped" << endl;
+    return 0;
+}
 
-    // Close the CSV file.
-    csvReader.close();
-}
\ No newline at end of file
+/**
+ * @brief Displays the state statistics of a CSV file.
+ * @param csvFile The CSV file to analyze.
+ * @param forceAnalysis Re-parses the CSV even if its cached analysis is current.
+ * @pre The CSV file has a header naming the zip code fields.
+ * @post State statistics are displayed, from the sidecar cache when the CSV is unchanged.
+ */
+//Displays state statistics of a CSV file, analyzing it only when needed.
+bool analyzeCSV(const string& csvFile, bool forceAnalysis) {
+    AnalysisCache cache(csvFile);
+    StateStats stats;
+    if (!cache.getStats(stats, forceAnalysis)) {
+        cerr << "Failed to analyze " << csvFile << "." << endl;
+        return false;
+    }
+    cout << (cache.wasCached() ? "Cached analysis of " : "Analyzed ") << csvFile << ".\n" << endl;
+    cout << stats.printTable() << endl;
+    return true;
+}
+
+/**
+ * @brief Adds or replaces every record of a CSV file through the write-optimized path.
+ *
+ * Once the store has merged the rows into the blocks, they are appended to the data file
+ * and the primary index, which the block file is rebuilt from on the next start. A row
+ * too long for a data file record is counted and left out of both.
+ *
+ * @param bf Reference to BFile object representing the database file.
+ * @param csvFile The CSV file to read, in any row order.
+ * @return Exit status of the program.
+ */
+//ingest a CSV file, merging its rows into the blocks in batches
+int ingestCSV(BFile& bf, const string& csvFile) {
+    ifstream inFile(csvFile);
+    if (!inFile.is_open()) {
+        cerr << "Cannot open " << csvFile << endl;
+        return 1;
+    }
+
+    string headerData;
+    delimBuffer buffer;
+    RowParser parser;
+    buffer.readHeader(inFile, headerData);
+    if (!parser.resolveHeader(headerData)) {
+        cerr << "Header is missing one or more zip code fields: " << headerData << endl;
+        return 1;
+    }
+
+    vector<ZipCode> ingested;
+    ZipCode record;
+    int tooLong = 0;
+    {
+        WriteOptimizedStore store(bf);
+        while (buffer.read(inFile)) {
+            if (buffer.getBuffer().empty() || !parser.parse(buffer.getBuffer(), record))
+                continue;
+            if (!PrimaryIndex::fits(record)) {
+                tooLong++;      // the data file could not hold it
+                continue;
+            }
+            store.put(record);
+            ingested.push_back(record);
+        }
+    }   // the store merges what is still buffered before it goes
+    bf.flush();
+
+    // a later row for the same zip code replaces the earlier one here too
+    PrimaryIndex indexList("IndexFile.index", "data.txt");
+    if (!indexList.append(ingested)) {
+        cerr << "Cannot append the ingested records to data.txt" << endl;
+        return 1;
+    }
+    if (!indexList.compact())
+        indexList.writeToFile();
+
+    int rows = ingested.size();
+    cout << rows << " rows ingested, " << tooLong << " too long for the data file and not written, "
+         << bf.getRecordCount() << " records in the file." << endl;
+    return 0;
+}
+
+/**
+ * @brief Deletes a list of retired zip codes from the block file and the primary index.
+ *
+ * Each block holding a retired zip code is rewritten once, and the primary index marks
+ * the zip codes deleted; the data file is rewritten only once enough of it is deleted.
+ *
+ * @param bf Reference to BFile object representing the database file.
+ * @param zipFile Whitespace-separated zip codes to delete.
+ * @return int Exit status of the command.
+ */
+int retireZips(BFile& bf, const string& zipFile) {
+    ifstream inFile(zipFile);
+    if (!inFile.is_open()) {
+        cerr << "Cannot open " << zipFile << endl;
+        return 1;
+    }
+
+    vector<int> zips;
+    int zip;
+    while (inFile >> zip)
+        zips.push_back(zip);
+
+    int removed = bf.removeRecords(zips);
+    bf.compact();
+    bf.flush();
+
+    PrimaryIndex indexList;
+    for (int retired : zips)
+        indexList.remove(retired);
+    if (!indexList.compact())
+        indexList.writeToFile();
+
+    cout << removed << " records retired, " << bf.getRecordCount() << " records in the file." << endl;
+    return 0;
+}
+
+/**
+ * @brief Applies a file of add, update and delete operations in one sorted pass.
+ *
+ * The file is a CSV whose header names an operation column followed by the zip code
+ * columns. Each row starts with A (add), U (update) or D (delete); a delete row needs
+ * only its zip code. The operations are sorted by zip code, the operations on one zip
+ * code are folded in file order, and the result is handed to BFile::applyChanges, which
+ * reads and rewrites each affected block once. An add of a zip code that is present, or
+ * an update or delete of one that is not, is rejected, and so is an add or update too
+ * long for a data file record. The header is written once at
+ * the end, and the primary index then appends the added and updated records to the
+ * data file and marks the deleted zip codes, as the block file is rebuilt from them.
+ *
+ * @param bf Reference to BFile object representing the database file.
+ * @param changeFile Name of the file of operations.
+ * @return int Exit status of the command.
+ */
+int applyChangeFile(BFile& bf, const string& changeFile) {
+    ifstream inFile(changeFile);
+    if (!inFile.is_open()) {
+        cerr << "Cannot open " << changeFile << endl;
+        return 1;
+    }
+
+    string headerData;
+    delimBuffer buffer;
+    RowParser parser;
+    buffer.readHeader(inFile, headerData);
+    if (!parser.resolveHeader(headerData)) {
+        cerr << "Header is missing one or more zip code fields: " << headerData << endl;
+        return 1;
+    }
+    int zipColumn = 0;
+    while (parser.getField(zipColumn) != FIELD_ZIP)
+        zipColumn++;
+
+    struct Operation {
+        int zip;
+        char kind;
+        ZipCode record;
+    };
+    vector<Operation> operations;
+    string field;
+    int malformed = 0, tooLong = 0;
+    while (buffer.read(inFile)) {
+        if (buffer.getBuffer().empty())
+            continue;
+        Operation operation;
+        field.clear();      // unpack appends
+        buffer.unpack(field);
+        operation.kind = field.empty() ? '?' : toupper(field[0]);
+        bool parsed;
+        if (operation.kind == 'D') {
+            for (int column = 1; column <= zipColumn; column++) {
+                field.clear();
+                buffer.unpack(field);
+            }
+            parsed = NumberCodec::parseInt(field.data(), field.data() + field.size(), operation.zip);
+        } else {
+            parsed = (operation.kind == 'A' || operation.kind == 'U')
+                && parser.parse(buffer.getBuffer(), operation.record);
+            operation.zip = operation.record.getNum();
+            if (parsed && !PrimaryIndex::fits(operation.record)) {
+                tooLong++;      // the data file could not hold it
+                continue;
+            }
+        }
+        if (parsed)
+            operations.push_back(operation);
+        else
+            malformed++;
+    }
+
+    // the operations on one zip code stay in file order
+    stable_sort(operations.begin(), operations.end(),
+        [](const Operation& a, const Operation& b) { return a.zip < b.zip; });
+
+    vector<RecordChange> changes;
+    vector<ZipCode> written;        // added and updated records, for the data file
+    vector<int> deleted;
+    int accepted = 0, rejected = 0;
+    ZipCodeView stored;
+    for (size_t first = 0; first < operations.size();) {
+        int zip = operations[first].zip;
+        bool wasPresent = bf.findRecord(zip, stored);
+        bool present = wasPresent;
+        const ZipCode* latest = nullptr;
+        size_t last = first;
+        for (; last < operations.size() && operations[last].zip == zip; last++) {
+            const Operation& operation = operations[last];
+            if ((operation.kind == 'A') == present) {
+                rejected++;
+                continue;
+            }
+            present = operation.kind != 'D';
+            latest = present ? &operation.record : nullptr;
+            accepted++;
+        }
+        first = last;
+
+        if (latest != nullptr) {
+            changes.push_back(RecordChange{zip, false, *latest});
+            written.push_back(*latest);
+        } else if (wasPresent && !present) {
+            changes.push_back(RecordChange{zip, true, ZipCode()});
+            deleted.push_back(zip);
+        }
+    }
+
+    int applied = bf.applyChanges(changes);
+    bf.flush();
+
+    PrimaryIndex indexList("IndexFile.index", "data.txt");
+    if (!indexList.append(written)) {
+        cerr << "Cannot append the changed records to data.txt" << endl;
+        return 1;
+    }
+    for (int zip : deleted)
+        indexList.remove(zip);
+    if (!indexList.compact())
+        indexList.writeToFile();
+
+    cout << accepted << " operations applied (" << applied << " records changed), "
+         << rejected << " rejected, " << malformed << " malformed, " << tooLong
+         << " too long for the data file and not written, " << bf.getRecordCount()
+         << " records in the file." << endl;
+    return 0;
+}
+
+/**
+ * @brief Brings the database up to date with a new copy of the CSV, writing only what changed.
+ *
+ * The new rows are sorted by zip code (a sorted vendor file is already in order) and
+ * merge-joined against the records of the sequence set, which come out in zip order.
+ * Zip codes only in the CSV are added, zip codes only in the file are removed, and
+ * records whose fields differ are replaced. The block file takes the differences as one
+ * BFile::applyChanges batch; the primary index appends the new and changed records to
+ * the data file and marks the removed zip codes deleted, instead of regenerating both.
+ * A row too long for a data file record is counted and its stored record kept.
+ *
+ * @param bf Reference to BFile object representing the database file.
+ * @param csvFile Name of the new CSV.
+ * @return int Exit status of the command.
+ */
+int reimportCSV(BFile& bf, const string& csvFile) {
+    ifstream inFile(csvFile);
+    if (!inFile.is_open()) {
+        cerr << "Cannot open " << csvFile << endl;
+        return 1;
+    }
+
+    string headerData;
+    delimBuffer buffer;
+    RowParser parser;
+    buffer.readHeader(inFile, headerData);
+    if (!parser.resolveHeader(headerData)) {
+        cerr << "Header is missing one or more zip code fields: " << headerData << endl;
+        return 1;
+    }
+
+    vector<ZipCode> incoming;
+    ZipCode record;
+    while (buffer.read(inFile)) {
+        if (!buffer.getBuffer().empty() && parser.parse(buffer.getBuffer(), record))
+            incoming.push_back(record);
+    }
+    auto byZip = [](const ZipCode& a, const ZipCode& b) { return a.getNum() < b.getNum(); };
+    if (!is_sorted(incoming.begin(), incoming.end(), byZip))
+        stable_sort(incoming.begin(), incoming.end(), byZip);
+
+    vector<ZipCode> stored;
+    bf.findRange(INT_MIN, INT_MAX, stored);
+
+    auto sameFields = [](const ZipCode& a, const ZipCode& b) {
+        return a.getCity() == b.getCity() && a.getStateCode() == b.getStateCode()
+            && a.getCounty() == b.getCounty() && a.getLatMicro() == b.getLatMicro()
+            && a.getLonMicro() == b.getLonMicro();
+    };
+
+    vector<RecordChange> changes;
+    vector<ZipCode> written;        // added and changed records, for the data file
+    vector<int> removed;
+    int added = 0, changed = 0, tooLong = 0;
+    size_t old = 0;
+    for (size_t row = 0; row < incoming.size(); row++) {
+        const ZipCode& fresh = incoming[row];
+        // a zip code repeated in the CSV keeps its last row
+        if (row + 1 < incoming.size() && incoming[row + 1].getNum() == fresh.getNum())
+            continue;
+        for (; old < stored.size() && stored[old].getNum() < fresh.getNum(); old++) {
+            changes.push_back(RecordChange{stored[old].getNum(), true, ZipCode()});
+            removed.push_back(stored[old].getNum());
+        }
+        bool present = old < stored.size() && stored[old].getNum() == fresh.getNum();
+        if (present && sameFields(stored[old], fresh)) {
+            old++;
+            continue;
+        }
+        if (!PrimaryIndex::fits(fresh)) {
+            // the data file could not hold the row, so the stored record stays as it is
+            tooLong++;
+            if (present)
+                old++;
+            continue;
+        }
+        changes.push_back(RecordChange{fresh.getNum(), false, fresh});
+        written.push_back(fresh);
+        if (present) {
+            changed++;
+            old++;
+        } else {
+            added++;
+        }
+    }
+    for (; old < stored.size(); old++) {
+        changes.push_back(RecordChange{stored[old].getNum(), true, ZipCode()});
+        removed.push_back(stored[old].getNum());
+    }
+
+    if (!changes.empty()) {
+        bf.applyChanges(changes);
+        bf.flush();
+
+        PrimaryIndex indexList("IndexFile.index", "data.txt");
+        if (!indexList.append(written)) {
+            cerr << "Cannot append the new and changed records to data.txt" << endl;
+            return 1;
+        }
+        for (int zip : removed)
+            indexList.remove(zip);
+        if (!indexList.compact())
+            indexList.writeToFile();
+    }
+
+    cout << added << " added, " << changed << " changed, " << removed.size() << " removed, "
+         << tooLong << " too long for the data file and not written, "
+         << stored.size() + added - removed.size() << " records." << endl;
+    return 0;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file ArenaAllocationTest.cpp
+ * @brief Checks that decoding blocks and parsing rows make no heap allocations per record
+ *        once their arenas and buffers are warm.
+ * @details Build and run from the repository root:
+ *          g++ -std=c++17 -mavx2 -msse4.2 -I. tests/ArenaAllocationTest.cpp BlockBuffer.cpp Block.cpp
+ *              Buffer_Record.cpp KeySearch.cpp CompressedBlockCodec.cpp CRC32C.cpp RowParser.cpp FieldScanner.cpp zipCode.cpp
+ *              StringPool.cpp StateCodes.cpp NumberCodec.cpp Arena.cpp -o ArenaAllocationTest
+ */
+
+#include "BlockBuffer.h"
+#include "PrimaryIndex.h"
+#include "RowParser.h"
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+
+// Every operator new in the program goes through here
+static size_t heapAllocations = 0;
+
+void* operator new(size_t bytes) {
+    heapAllocations++;
+    if (void* p = malloc(bytes ? bytes : 1))
+        return p;
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// A full block of the given encoding, as it is stored in the file
+static string sampleBlock(BlockEncoding encoding, int& records) {
+    Block block;
+    block.setEncoding(encoding);
+    for (int zip = 1001; block.insertRecord(ZipCode(zip, "Springfield", "MA", "Hampden", 42.1, -72.5)); zip++)
+        ;
+    records = block.getRecordCount();
+    BlockBuffer buffer;
+    buffer.pack(block);
+    return buffer.getText();
+}
+
+// Heap allocations per record of decoding a block with unpack and with nextRecord
+static void checkDecode(BlockEncoding encoding) {
+    int records;
+    string image = sampleBlock(encoding, records);
+    BlockBuffer buffer;
+    ZipCodeView view;
+
+    const int rounds = 100;
+    size_t before = 0;
+    for (int round = -1; round < rounds; round++) {
+        if (round == 0)
+            before = heapAllocations;     // the first round grows the arena and buffers
+        buffer.assign(image);
+        {
+            ArenaScope scope(*buffer.getArena());
+            Block block(buffer.getArena());
+            buffer.unpack(block);
+            assert(block.getRecordCount() == records);
+        }
+        buffer.assign(image);
+        Block header;
+        buffer.beginRecords(header);
+        int seen = 0;
+        while (buffer.nextRecord(view))
+            seen++;
+        assert(seen == records);
+    }
+    // assign copies the image into the buffer's existing capacity
+    assert(heapAllocations - before == 0);
+
+    // the same decode into a Block without an arena does reach the heap
+    before = heapAllocations;
+    Block heapBlock;
+    buffer.assign(image);
+    buffer.unpack(heapBlock);
+    assert(heapAllocations > before);
+}
+
+// Heap allocations per row of parsing into an arena-backed state bucket
+static void checkParse() {
+    RowParser parser;
+    assert(parser.resolveHeader("\"ZipCode\",\"PlaceName\",State,County,Lat,Long"));
+    string row = "1001,\"Agawam\",MA,Hampden,42.0702,-72.6227";
+
+    Arena arena;
+    ZipCode record;
+    const int rows = 1000;
+    size_t before = 0;
+    for (int round = -1; round < 10; round++) {
+        if (round == 0)
+            before = heapAllocations;     // the first round interns the strings and grows the arena
+        ArenaScope scope(arena);
+        StateBucket bucket{ArenaAllocator<ZipCode>(&arena)};
+        bucket.reserve(rows);
+        for (int i = 0; i < rows; i++) {
+            assert(parser.parse(row, record));
+            bucket.push_back(record);
+        }
+    }
+    assert(heapAllocations - before == 0);
+}
+
+int main() {
+    checkDecode(ASCII_BLOCK);
+    checkDecode(COMPRESSED_BLOCK);
+    checkParse();
+    cout << "ArenaAllocationTest passed" << endl;
+    return 0;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file FieldScannerTest.cpp
+ * @brief Checks FieldScanner::split against the cases the scalar parser handled.
+ * @details Build and run from the repository root:
+ *          g++ -std=c++17 -mavx2 -I. tests/FieldScannerTest.cpp FieldScanner.cpp -o FieldScannerTest
+ */
+
+#include "FieldScanner.h"
+#include <cassert>
+#include <iostream>
+
+// Field i of text as the reader would see it
+static string field(const string& text, const vector<FieldSpan>& spans, int i) {
+    string out;
+    FieldScanner::unescape(text.data(), spans[i], out);
+    return out;
+}
+
+int main() {
+    vector<FieldSpan> spans;
+
+    // a trailing delimiter ends the row with an empty field
+    string trailing = "a,b,";
+    assert(FieldScanner::split(trailing, ',', spans) == 4);
+    assert(spans.size() == 3);
+    assert(field(trailing, spans, 0) == "a");
+    assert(field(trailing, spans, 1) == "b");
+    assert(field(trailing, spans, 2) == "");
+
+    string onlyDelims = ",,";
+    FieldScanner::split(onlyDelims, ',', spans);
+    assert(spans.size() == 3);
+
+    string empty = "";
+    FieldScanner::split(empty, ',', spans);
+    assert(spans.empty());
+
+    string trailingLine = "a,b,\r\nc";
+    assert(FieldScanner::split(trailingLine, ',', spans) == 6);
+    assert(spans.size() == 3 && spans[2].length == 0);
+
+    // "" inside a quoted field is one quote and does not end the field
+    string quoted = "1,\"say \"\"hi\"\", then go\",x";
+    FieldScanner::split(quoted, ',', spans);
+    assert(spans.size() == 3);
+    assert(!spans[0].escaped && spans[1].escaped && !spans[2].escaped);
+    assert(field(quoted, spans, 1) == "say \"hi\", then go");
+    assert(field(quoted, spans, 2) == "x");
+
+    string onlyQuotes = "\"\"\"a\"\"\",\"\"";
+    FieldScanner::split(onlyQuotes, ',', spans);
+    assert(spans.size() == 2);
+    assert(field(onlyQuotes, spans, 0) == "\"a\"");
+    assert(field(onlyQuotes, spans, 1) == "");
+
+    // a quoted field may span lines and still end in a trailing empty field
+    string multiLine = "\"a\nb\",";
+    FieldScanner::split(multiLine, ',', spans);
+    assert(spans.size() == 2 && field(multiLine, spans, 0) == "a\nb" && spans[1].length == 0);
+
+    // long rows go through the vector paths
+    string wide = string(40, 'x') + ",\"" + string(40, 'y') + "\"\"" + string(40, 'z') + "\",";
+    FieldScanner::split(wide, ',', spans);
+    assert(spans.size() == 3);
+    assert(field(wide, spans, 1) == string(40, 'y') + "\"" + string(40, 'z'));
+
+    cout << "FieldScannerTest passed" << endl;
+    return 0;
+}
@@ -5,6 +5,7 @@
  */
 
 #include "zipCode.h"
+#include "NumberCodec.h"
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -16,63 +17,50 @@ ZipCode::ZipCode() {
     // @brief Default Constructor
     // @post Initializes a ZipCode object with default (empty or zero) values.
     num = -1;
-    city = "";
-    stateCode = "";
-    county = "";
-    lat = 0;
-    lon = 0;
+    cityId = 0;
+    stateId = StateCodes::NoState;
+    countyId = 0;
+    latMicro = 0;
+    lonMicro = 0;
 }
 
 // Parameterized Constructor
-ZipCode::ZipCode(int newNum, string newCity, string newStateCode, string newCounty, float newLat, float newLon) {
+ZipCode::ZipCode(int newNum, string_view newCity, string_view newStateCode, string_view newCounty, double newLat, double newLon) {
     // @brief Parameterized Constructor
     // @pre Accepts individual parameters for each member variable.
     // @post Initializes a ZipCode object with provided values.
     num = newNum;
-    city = newCity;
-    stateCode = newStateCode;
-    county = newCounty;
-    lat = newLat;
-    lon = newLon;
+    setCity(newCity);
+    setStateCode(newStateCode);
+    setCounty(newCounty);
+    setLat(newLat);
+    setLon(newLon);
 }
 
-// Copy Constructor
-ZipCode::ZipCode(const ZipCode& oldZip) {
-    // @brief Copy Constructor
-    // @pre Accepts an existing ZipCode object.
-    // @post Creates a new ZipCode object as a copy of the existing one.
-    num = oldZip.num;
-    city = oldZip.city;
-    stateCode = oldZip.stateCode;
-    county = oldZip.county;
-    lat = oldZip.lat;
-    lon = oldZip.lon;
+// Fixed-point constructor
+ZipCode ZipCode::fromMicroDegrees(int newNum, string_view newCity, string_view newStateCode,
+                                  string_view newCounty, int newLatMicro, int newLonMicro) {
+    // @brief Builds a ZipCode without converting the coordinates through a float.
+    // @post The coordinates are exactly the given micro-degree values.
+    ZipCode zip;
+    zip.setNum(newNum);
+    zip.setCity(newCity);
+    zip.setStateCode(newStateCode);
+    zip.setCounty(newCounty);
+    zip.setLatMicro(newLatMicro);
+    zip.setLonMicro(newLonMicro);
+    return zip;
 }
 
 // Function to get the size of the ZipCode data
-const int ZipCode::getSize() {
+int ZipCode::getSize() const {
     // @brief Gets the size of the ZipCode data.
     // @return The size of the ZipCode data as an integer.
-    string size = "";
-    string temp = "";
+    // Counted as five separators, the ASCII length of the fields, a comma and the fields.
+    int fields = NumberCodec::intLength(num) + getCity().size() + getStateCode().size() + getCounty().size()
+               + NumberCodec::fixed6Length(latMicro) + NumberCodec::fixed6Length(lonMicro);
 
-    temp.append(to_string(num));
-    size.push_back(',');
-    temp.append(city);
-    size.push_back(',');
-    temp.append(stateCode);
-    size.push_back(',');
-    temp.append(county);
-    size.push_back(',');
-    temp.append(to_string(lat));
-    size.push_back(',');
-    temp.append(to_string(lon));
-
-    size.append(to_string(temp.size()));
-    size.push_back(',');
-    size.append(temp);
-
-    return size.size();
+    return 5 + NumberCodec::intLength(fields) + 1 + fields;
 }
 
 // Static method to read zip codes from a file
@@ -88,7 +76,7 @@ vector<ZipCode> ZipCode::readFromFile(const string& filename) {
         stringstream ss(line);
         int num;
         string city, stateCode, county;
-        float lat, lon;
+        double lat, lon;
 
         ss >> num;
         getline(ss, city, ',');
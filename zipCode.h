@@ -6,8 +6,15 @@
 #ifndef ZIP_CODE
 #define ZIP_CODE
 
+#include "NumberCodec.h"
+#include "StateCodes.h"
+#include "StringPool.h"
+#include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 using namespace std;
 
@@ -21,31 +28,43 @@ public:
     // @brief Initializes a ZipCode object with specific values.
     // @pre Requires zip code, city, state code, county, latitude, and longitude.
     // @post ZipCode object initialized with given values.
-    ZipCode(int newNum, string newCity, string newStateCode, string newCounty, float newLat, float newLon);
+    ZipCode(int newNum, string_view newCity, string_view newStateCode, string_view newCounty, double newLat, double newLon);
 
-    // Copy constructor
-    // @brief Initializes a ZipCode object as a copy of another ZipCode object.
-    ZipCode(const ZipCode& oldZip);
+    // Fixed-point constructor
+    // @brief Initializes a ZipCode object with coordinates already in micro-degrees.
+    static ZipCode fromMicroDegrees(int newNum, string_view newCity, string_view newStateCode,
+                                    string_view newCounty, int newLatMicro, int newLonMicro);
 
     // Setters and Getters
     // @brief Set and get methods for ZipCode properties.
-    void setNum(int newNum);
-    const int getNum();
-    void setCity(string newCity);
-    const string getCity();
-    void setStateCode(string newStateCode);
-    const string getStateCode();
-    void setCounty(string newCounty);
-    const string getCounty();
-    void setLat(float newLat);
-    const float getLat();
-    void setLon(float newLon);
-    const float getLon();
+    // @post The text fields are interned, so the views returned stay valid for the whole run.
+    void setNum(int newNum) { num = newNum; }
+    int getNum() const { return num; }
+    void setCity(string_view newCity) { cityId = StringPool::shared().intern(newCity); }
+    string_view getCity() const { return StringPool::shared().lookup(cityId); }
+    void setStateCode(string_view newStateCode) { stateId = StateCodes::intern(newStateCode); }
+    string_view getStateCode() const { return StateCodes::code(stateId); }
+    void setCounty(string_view newCounty) { countyId = StringPool::shared().intern(newCounty); }
+    string_view getCounty() const { return StringPool::shared().lookup(countyId); }
+    // @brief Coordinates are kept in micro-degrees. The float forms are for display and
+    //        for callers that only have a float; parsing text goes straight to the integer.
+    void setLat(double newLat) { latMicro = toMicroDegrees(newLat); }
+    float getLat() const { return latMicro / float(NumberCodec::Fixed6Scale); }
+    void setLon(double newLon) { lonMicro = toMicroDegrees(newLon); }
+    float getLon() const { return lonMicro / float(NumberCodec::Fixed6Scale); }
+    void setLatMicro(int newLat) { latMicro = newLat; }
+    int getLatMicro() const { return latMicro; }
+    void setLonMicro(int newLon) { lonMicro = newLon; }
+    int getLonMicro() const { return lonMicro; }
+
+    // @brief Gets the state's index in the StateCodes table.
+    // @return 0 to StateCodes::NumStates - 1, or a larger id for a code outside the table.
+    int getStateIndex() const { return stateId; }
 
     // Method to get the size of the ZipCode data
     // @brief Gets the size of the ZipCode data.
     // @return The size of the ZipCode data as an integer.
-    const int getSize();
+    int getSize() const;
 
     // Method to print the ZipCode information
     // @brief Prints the details of the ZipCode object.
@@ -58,12 +77,18 @@ public:
     static vector<ZipCode> readFromFile(const string& filename);
 
 private:
+    static int toMicroDegrees(double degrees) { return lround(degrees * NumberCodec::Fixed6Scale); }
+
+    // Text fields are ids into the shared pools, which keeps a ZipCode at 24 bytes
+    // and lets vectors of them be copied and moved as plain memory.
     int num;
-    float lat;
-    float lon;
-    string stateCode;
-    string city;
-    string county;
+    int latMicro;
+    int lonMicro;
+    uint32_t cityId;
+    uint32_t countyId;
+    uint8_t stateId;
 };
 
+static_assert(is_trivially_copyable<ZipCode>::value, "ZipCode must stay trivially copyable");
+
 #endif // ZIP_CODE